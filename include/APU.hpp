@@ -1,15 +1,95 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+
+#include <vector>
+
+#include <apu/PulseChannel.hpp>
+#include <apu/TriangleChannel.hpp>
+#include <apu/NoiseChannel.hpp>
+#include <apu/DmcChannel.hpp>
+#include <apu/BlipBuffer.hpp>
+
+class Bus;
+class StateWriter;
+class StateReader;
 
 class APU {
 public:
+    static constexpr int CPU_CLOCK = 1789773;
+    static constexpr int SAMPLE_RATE = 44100;
+
+    PulseChannel pulse1;
+    PulseChannel pulse2;
+    TriangleChannel triangle;
+    NoiseChannel noise;
+    DmcChannel dmc;
+
     APU();
     ~APU();
 
+    void connectBus(Bus* bus);
+
+    // back to the power-on state, the output level glides there instead of clicking
+    void reset();
+
+    // $4000-$4013
+    void writeRegister(uint16_t address, uint8_t value);
     void writeStatus(uint8_t value);
     uint8_t readStatus();
+    void writeFrameCounter(uint8_t value);
+
+    // advances the APU clock by the given number of CPU cycles, the channels themselves only
+    // catch up when something could observe them or the frame ends
+    void tick(uint64_t cycles);
+
+    // runs everything up to the current clock and resamples the frame into the sample buffer
+    void endFrame();
+
+    bool pollIrq() const;
+
+    // scales the output sample rate slightly so a consumer can keep its buffer level steady
+    void setSampleRateAdjust(double ratio);
+
+    const int16_t* getSamples() const;
+    size_t getSampleCount() const;
+    void clearSamples();
+
+    // samples not yet taken with getSamples are not part of the state, loading starts a
+    // fresh frame of output that continues the waveform seamlessly
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
 
 private:
-    uint8_t status;
-};
\ No newline at end of file
+    // frames never get this long, but step() callers may never end one
+    static constexpr uint32_t MAX_FRAME_CYCLES = 60000;
+
+    void run(uint32_t end);
+    void runChannels(uint32_t end);
+    void scheduleSync();
+
+    uint16_t nextFrameCounterStep() const;
+    void clockFrameCounter();
+    void clockQuarterFrame();
+    void clockHalfFrame();
+
+    int32_t mix() const;
+    void updateOutput();
+
+    bool fiveStepMode;
+    bool irqInhibit;
+    bool frameIrq;
+    uint16_t frameCycle;
+
+    // CPU cycles since the frame started: channels have been run up to time, the CPU is at
+    // targetTime and nothing can be observed before syncTime
+    uint32_t time;
+    uint32_t targetTime;
+    uint32_t syncTime;
+
+    BlipBuffer blip;
+    int32_t amplitude;
+
+    std::vector<int16_t> samples;
+};
@@ -5,10 +5,15 @@
 #include <PPU.hpp>
 #include <APU.hpp>
 #include <Joypad.hpp>
+#include <Stats.hpp>
+
+class StateWriter;
+class StateReader;
+class Coverage;
 
 class Bus {
 public:
-    Bus(PPU* ppu, APU* apu, Joypad* joypad);
+    Bus(PPU* ppu, APU* apu, Joypad* joypad, Joypad* joypad2, Stats* stats);
     ~Bus();
 
     void write(uint16_t address, uint8_t data);
@@ -16,19 +21,48 @@ public:
 
     uint8_t read(uint16_t address);
     uint16_t readWord(uint16_t address);
+    // a read of an opcode or operand by the CPU, counted as executed rather than read
+    uint8_t fetch(uint16_t address);
+    // any other read that coverage should see as something else, like DMC sample fetches
+    uint8_t read(uint16_t address, uint8_t coverageFlag);
+    // RAM, PRG RAM and PRG ROM as the CPU would see them, without side effects, stats or
+    // coverage, for tools looking at the machine from outside. registers read as 0
+    uint8_t peek(uint16_t address) const;
 
     void writeBytes(uint16_t address, uint8_t* data, int size);
 
     void Zero();
+    // internal RAM only, the cartridge keeps its PRG ROM and PRG RAM like a battery backed board
+    void clearRam();
 
     void tickPPU(uint8_t cycles);
 
+    // DMA units (OAM and DMC) halt the CPU; the stolen cycles are collected
+    // here and paid for by System before the next instruction.
+    void stall(uint16_t cycles);
+    uint16_t takeStallCycles();
+
+    // owned by System, the DMC channel counts its fetches here too
+    Stats* stats;
+    // null unless coverage is being recorded
+    Coverage* coverage;
+
     bool pollNmiStatus();
+    bool pollIrqStatus();
+
+    // internal RAM and PRG RAM, PRG ROM comes back from the cartridge
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
 
 private:
     uint8_t* cpuMemory;
     uint8_t* prgMemory;
+    // $6000-$7FFF on the cartridge, where test ROMs also report their results
+    uint8_t* prgRam;
     PPU* ppu;
     APU* apu;
     Joypad* joypad;
+    Joypad* joypad2;
+
+    uint16_t stallCycles;
 };
\ No newline at end of file
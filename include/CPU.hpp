@@ -9,6 +9,12 @@
 
 #include <Interrupt.hpp>
 
+class System;
+class Profiler;
+class Symbols;
+class StateWriter;
+class StateReader;
+
 enum class AddressingMode {
     IMP, // Implied
     ACC, // Accumulator
@@ -36,8 +42,17 @@ public:
     uint8_t flags;
 
     Bus* memory;
+    // the machine this CPU is part of, for its stop flag and to clock the PPU and APU during interrupts
+    System* system;
+
+    // print a nestest style trace line after every instruction
+    bool logging;
+    // told about every call, return and cycle when set, null otherwise
+    Profiler* profiler;
+    // names operands in the trace and disassembly when set
+    Symbols* symbols;
 
-    CPU(Bus* memory);
+    CPU(Bus* memory, System* system);
 
     void powerOn();
     void reset();
@@ -84,14 +99,21 @@ public:
 
     std::string getAddressWithMode(AddressingMode mode);
 
+    // a symbol name for address if there is one, otherwise $ and the address in hex
+    std::string formatAddress(uint16_t address, int digits);
+
     uint16_t getAddressWithModeValue(AddressingMode mode);
 
     uint16_t getAddress(AddressingMode mode);
 
     size_t getCycles();
+    void stall(uint16_t cycles);
 
     void interrupt(const interrupt::Interrupt& interrupt);
 
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
 private:
     size_t cycles;
     uint8_t fetch();
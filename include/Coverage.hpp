@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <ostream>
+
+// which bytes of RAM and the cartridge the CPU ran, read or wrote. while attached to the bus every
+// access is one OR into a flag byte per CPU address; the mirrors and the PRG banks are only
+// folded together when the map is written out
+class Coverage {
+public:
+    static constexpr uint8_t EXECUTED = 0x01;
+    static constexpr uint8_t READ = 0x02;
+    static constexpr uint8_t WRITTEN = 0x04;
+    // fetched by the DMC as sample data
+    static constexpr uint8_t SAMPLE = 0x08;
+
+    // prgSize is the PRG ROM in the cartridge, 16K or 32K for NROM, chrSize its CHR ROM
+    Coverage(size_t prgSize, size_t chrSize);
+    ~Coverage();
+
+    void mark(uint16_t address, uint8_t flags) {
+        map[address] |= flags;
+    }
+
+    void clear();
+
+    // the flags as 2K of RAM, 8K of PRG RAM and then the PRG ROM in file order
+    bool writeMap(const char* path) const;
+    // an FCEUX code/data log, which Mesen also reads: a byte per PRG ROM byte and then one per
+    // CHR ROM byte, left empty since the PPU isn't tracked
+    bool writeCdl(const char* path) const;
+
+    // writeCdl for a path ending in .cdl, writeMap for anything else
+    bool write(const char* path) const;
+
+    // bytes touched in each region and how much of PRG ROM ran
+    void summary(std::ostream& out) const;
+
+private:
+    uint8_t* map;
+    size_t prgSize;
+    size_t chrSize;
+
+    // the flags of a PRG ROM byte, from every CPU address it shows up at
+    uint8_t prgFlags(size_t offset) const;
+};
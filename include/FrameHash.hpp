@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <System.hpp>
+#include <Movie.hpp>
+
+// separate hashes of the picture and the audio so a mismatch says which one changed, both
+// 64-bit FNV-1a through Movie::hashBytes like the ROM hash
+struct FrameHash {
+    uint64_t video;
+    uint64_t audio;
+
+    FrameHash();
+
+    // folds in view's palette indices, if it has any, and its samples, in little endian so the
+    // result doesn't depend on the host. a fresh FrameHash per frame gives per-frame hashes, one
+    // kept across frames hashes the whole run
+    void add(const FrameView& view);
+};
@@ -5,6 +5,7 @@
 namespace interrupt {
     enum class InterruptType {
         NMI,
+        IRQ,
     };
 
     struct Interrupt {
@@ -27,4 +28,11 @@ namespace interrupt {
         0b00100000,
         2
     };
+
+    const Interrupt IRQ = {
+        InterruptType::IRQ,
+        0xfffE,
+        0b00100000,
+        2
+    };
 }
@@ -11,6 +11,9 @@
 #define JOYPAD_LEFT 0x40
 #define JOYPAD_RIGHT 0x80
 
+class StateWriter;
+class StateReader;
+
 class Joypad {
 public:
     Joypad();
@@ -20,6 +23,13 @@ public:
     uint8_t read();
 
     void setButtonState(uint8_t button, bool pressed);
+    // all eight buttons at once, one JOYPAD_* bit each
+    void setState(uint8_t buttons);
+    uint8_t getState() const;
+
+    // the held buttons belong to the host, only the shift register position is saved
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
 private:
     uint8_t joypadState;
     uint8_t buttonIndex;
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// text for inside a JSON string literal: quotes and backslashes escaped, newlines and tabs as
+// \n and \t and any other control character as \u00XX
+std::string escapeJson(const std::string& text);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// small LZ77 codec in the LZ4 block layout: a token byte holds the literal run and match
+// lengths, followed by the literals and a 16 bit back offset. one greedy pass with a hash
+// of the next four bytes, tuned for savestates and their XOR deltas, which are mostly zero
+namespace lz {
+    // worst case output size for incompressible input
+    constexpr size_t maxCompressedSize(size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    // returns the compressed size, or 0 if dst is too small
+    size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+    // returns the decompressed size, or 0 if src is malformed or dst is too small
+    size_t decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <vector>
+
+#include <System.hpp>
+
+#define MOVIE_RESET 0x01
+#define MOVIE_POWER 0x02
+
+// start value for Movie::hashBytes
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+
+// the input for one frame, applied before the frame runs
+struct MovieFrame {
+    uint8_t commands;  // MOVIE_RESET and MOVIE_POWER bits
+    uint8_t joypad[2];  // JOYPAD_* bits for each controller port
+};
+
+// a recording of everything that drives the machine besides the cartridge: one MovieFrame per
+// frame from power on. playing it back against the same ROM replays the session exactly
+class Movie {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    // 0 when unknown, imported movies identify their ROM some other way
+    uint64_t romHash;
+    std::vector<MovieFrame> frames;
+
+    Movie();
+    ~Movie();
+
+    // .fm2 files go through loadFm2, anything else must be in this class's own format
+    bool load(const char* path);
+    bool save(const char* path) const;
+
+    // imports an FCEUX text movie: gamepads in ports 0 and 1, soft and hard resets.
+    // movies that start from a savestate or use other devices are rejected
+    bool loadFm2(const char* path);
+
+    // 64-bit FNV-1a of the whole ROM file, 0 if it can't be read
+    static uint64_t hashRom(const char* path);
+    // folds size bytes into a 64-bit FNV-1a hash, FrameHash uses it for frames too
+    static uint64_t hashBytes(uint64_t hash, const uint8_t* data, size_t size);
+
+    // appends one frame of input taken from the machine's joypads
+    void record(const System* system, uint8_t commands);
+    // feeds frame's input to the machine, false once the movie has run out
+    bool apply(System* system, size_t frame) const;
+};
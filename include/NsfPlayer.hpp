@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <System.hpp>
+
+namespace Nsf {
+// multi-byte fields are little endian and unaligned, so they are kept as byte pairs
+struct nsf_header
+{
+    uint8_t magic[5];           // "NESM", 0x1A
+    uint8_t version;
+    uint8_t total_songs;
+    uint8_t starting_song;      // 1 based
+    uint8_t load_addr[2];
+    uint8_t init_addr[2];
+    uint8_t play_addr[2];
+    char name[32];
+    char artist[32];
+    char copyright[32];
+    uint8_t ntsc_speed[2];      // microseconds between PLAY calls
+    uint8_t bankswitch[8];      // all zero for non bankswitched tunes
+    uint8_t pal_speed[2];
+    uint8_t region;
+    uint8_t extra_sound_chips;
+    uint8_t reserved[4];
+};
+}
+
+// plays NSF tunes by calling their INIT and PLAY routines on a System whose PPU is never
+// clocked, so only the CPU and APU do any work
+class NsfPlayer {
+public:
+    System* system;
+
+    uint8_t songCount;
+    uint8_t startingSong;
+    std::string title;
+    std::string artist;
+    std::string copyright;
+    // PLAY calls that were due while the last routine was still running, they are dropped
+    // like on a hardware player so the tune keeps the header's rate
+    uint64_t skippedPlays;
+
+    NsfPlayer(std::string path);
+    ~NsfPlayer();
+
+    bool isLoaded() const;
+
+    // song is 1 based like the header's starting song
+    void selectSong(uint8_t song);
+
+    // runs one PLAY call, or carries on with the one that overran, and idles until the next
+    // one is due. pixels are not produced
+    FrameView playFrame();
+
+private:
+    // CPU jumps here when the routine called by callRoutine returns, nothing is mapped there
+    static constexpr uint16_t RETURN_ADDRESS = 0x4FF0;
+
+    bool callRoutine(uint16_t address, uint64_t maxCycles);
+    uint64_t runCpu(uint64_t maxCycles);
+
+    bool loaded;
+    uint16_t loadAddress;
+    uint16_t initAddress;
+    uint16_t playAddress;
+    uint64_t cyclesPerPlay;
+    // the CPU cycle the current frame started at, frames end on a fixed grid from it
+    uint64_t frameStart;
+    // the last INIT or PLAY call hasn't returned yet, the next frame carries on with it
+    bool routineRunning;
+};
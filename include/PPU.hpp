@@ -11,6 +11,9 @@
 #include <ppuRegisters/StatusRegister.hpp>
 #include <ppuRegisters/ScrollRegister.hpp>
 
+class StateWriter;
+class StateReader;
+
 enum class Mirroring {
     HORIZONTAL,
     VERTICAL,
@@ -19,6 +22,9 @@ enum class Mirroring {
 
 class PPU {
 public:
+    static constexpr int SCREEN_WIDTH = 256;
+    static constexpr int SCREEN_HEIGHT = 240;
+
     uint8_t* vram;
     uint8_t* oam;
     uint8_t* palette;
@@ -26,6 +32,11 @@ public:
     uint8_t oamAddr;
     Mirroring mirroring;
 
+    // one NES palette index (0x00-0x3F) per pixel, filled in when vblank starts
+    uint8_t* frameBuffer;
+    // cleared for frames nobody will see, vblank then leaves frameBuffer alone
+    bool renderFrames;
+
     bool nmiInterrupt;
 
     ControlRegister* controlRegister;
@@ -37,7 +48,10 @@ public:
     PPU();
     ~PPU();
 
-    bool tick(uint8_t cycles);
+    bool tick(uint16_t cycles);
+
+    // clears everything but the cartridge's CHR ROM and mirroring, as at power on
+    void reset();
 
     void setChrRom(uint8_t* chrRom, size_t size);
 
@@ -58,12 +72,27 @@ public:
     uint8_t readFromDataRegister();
 
     bool pollNmiInterrupt();
+
+    void renderFrame();
+
+    // maps $2000-$3EFF onto vram for the cartridge's mirroring
+    uint16_t mirrorVramAddress(uint16_t address);
+
+    // CHR ROM and the frame buffer are not saved, the frame is redrawn at the next vblank
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
 private:
+    // nametable bytes mirrorVramAddress can reach, four screen mirroring included
+    static constexpr size_t NAMETABLE_SIZE = 0x1000;
+
     uint8_t dataBuffer;
 
-    uint16_t mirrorVramAddress(uint16_t address);
+    uint8_t mirrorPaletteAddress(uint16_t address);
     void incrementVramAddress();
 
+    void renderBackground();
+    void renderSprites();
+
     size_t cycles;
     uint16_t scanline;
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Symbols;
+
+// how a routine on the shadow call stack was entered
+enum class CallKind : uint8_t {
+    ROOT,  // whatever ran from reset
+    JSR,
+    NMI,
+    IRQ,
+    BRK
+};
+
+// attributes CPU cycles to the 6502 routine running them. CPU::execOnce reports every call and
+// return, the profiler keeps a shadow call stack and a tree of every call path seen, and writes
+// the tree out in the collapsed stack format flamegraph.pl, inferno and speedscope read
+class Profiler {
+public:
+    // routines are named from symbols when it's given, and by address otherwise
+    Profiler(Symbols* symbols = nullptr);
+    ~Profiler();
+
+    // address is where the routine starts, stackPointer what S was before the call pushed
+    // anything, so the matching RTS or RTI brings it back to the same value
+    void call(uint16_t address, uint8_t stackPointer, CallKind kind);
+    // pops every frame the return unwound past, which also copes with routines that drop their
+    // return address or return through a pushed one
+    void ret(uint8_t stackPointer);
+    // back to just the root, after a reset
+    void resetStack();
+
+    void addCycles(uint32_t cycles) {
+        Node& node = nodes[stack[depth - 1].node];
+        if (node.frameCycles == 0 && cycles > 0) {
+            touched.push_back(stack[depth - 1].node);
+        }
+        node.cycles += cycles;
+        node.frameCycles += cycles;
+    }
+
+    // closes the current frame's breakdown, call once per displayed frame
+    void endFrame();
+
+    uint64_t getTotalCycles() const;
+
+    // one "root;caller;callee cycles" line per call path with cycles of its own. perFrame adds
+    // a "frame N" root so each frame gets its own tower
+    bool writeCollapsed(const char* path, bool perFrame) const;
+
+private:
+    static constexpr size_t MAX_DEPTH = 128;
+
+    struct Node {
+        uint16_t address;
+        CallKind kind;
+        uint32_t parent;
+        uint64_t cycles;
+        uint64_t frameCycles;
+    };
+
+    struct StackEntry {
+        uint32_t node;
+        uint8_t stackPointer;
+    };
+
+    struct FrameSample {
+        uint32_t frame;
+        uint32_t node;
+        uint64_t cycles;
+    };
+
+    Symbols* symbols;
+
+    std::vector<Node> nodes;
+    // (parent, kind, address) to child node
+    std::unordered_map<uint64_t, uint32_t> children;
+
+    StackEntry stack[MAX_DEPTH];
+    size_t depth;
+
+    std::vector<uint32_t> touched;
+    std::vector<FrameSample> frames;
+    uint32_t frameNumber;
+
+    std::string pathOf(uint32_t node) const;
+};
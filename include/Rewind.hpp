@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <System.hpp>
+#include <Movie.hpp>
+#include <Lz.hpp>
+
+// rewind history in a fixed amount of memory. every pushed savestate is stored LZ compressed,
+// either whole (a keyframe) or XORed against the newest keyframe, which leaves mostly zeros.
+// once the arena is full the oldest keyframe is dropped together with the deltas that need it
+class RewindBuffer {
+public:
+    static constexpr size_t DEFAULT_KEYFRAME_INTERVAL = 60;
+
+    RewindBuffer(size_t capacityBytes, size_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+    ~RewindBuffer();
+
+    // snapshots the machine, call once per frame
+    void push(const System* system);
+    // restores the newest snapshot and forgets it, false once the history is empty
+    bool pop(System* system);
+
+    // one frame of rewinding for a frontend that pushes before every frame it runs. goes back two
+    // frames and sets up the older one to run again with the input it had, so the caller has a
+    // picture to show and the machine, the history, record and frame all end one frame back.
+    // frame counts the frames run, record loses its newest frame. false, with nothing to run,
+    // at the start of the history
+    bool stepBack(System* system, Movie* record, const Movie* playback, size_t& frame);
+
+    void clear();
+
+    size_t getEntryCount() const;
+    size_t getBytesUsed() const;
+
+private:
+    struct Entry {
+        uint64_t id;
+        uint32_t offset;
+        uint32_t size;
+        bool keyframe;
+    };
+
+    Entry& entryAt(size_t index);
+    size_t findKeyframe(size_t index);
+    bool decodeKeyframe(size_t index);
+
+    uint8_t* allocate(size_t size);
+    void evictOldest();
+
+    size_t keyframeInterval;
+
+    // compressed entries laid out back to back, wrapping to the start when the end is reached
+    uint8_t* arena;
+    size_t capacity;
+    size_t writePosition;
+
+    Entry* entries;
+    size_t maxEntries;
+    size_t oldest;
+    size_t count;
+    uint64_t nextId;
+
+    // scratch space so pushing and popping never allocate
+    uint8_t state[System::SAVESTATE_SIZE];
+    uint8_t keyframe[System::SAVESTATE_SIZE];
+    size_t keyframeSize;
+    uint64_t keyframeId;
+    uint8_t compressed[lz::maxCompressedSize(System::SAVESTATE_SIZE)];
+};
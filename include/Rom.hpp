@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <Bus.hpp>
 #include <PPU.hpp>
 
@@ -19,4 +20,11 @@ struct nes_header
 };
 
 void loadRom(const char* path, Bus* memory, PPU* ppu);
+// false if path isn't an iNES file
+bool readHeader(const char* path, nes_header& header);
+int getMapper(const nes_header& header);
+// where PRG ROM starts in the file, past the 512 byte trainer if flag 6 says there is one
+size_t getPrgOffset(const nes_header& header);
+// false if the file is shorter than the trainer, PRG ROM and CHR ROM its header declares
+bool hasFullImage(const char* path, const nes_header& header);
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+// cursors over a caller-owned savestate buffer. every component writes its fields in a fixed
+// order in host byte order, nothing is allocated and running off the end only sets a flag
+
+class StateWriter {
+public:
+    StateWriter(uint8_t* buffer, size_t capacity) : buffer(buffer), capacity(capacity), position(0), overflow(false) {}
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "savestate fields must be plain data");
+        writeBytes(&value, sizeof(T));
+    }
+
+    void writeBytes(const void* data, size_t size) {
+        if (overflow || size > capacity - position) {
+            overflow = true;
+            return;
+        }
+        std::memcpy(buffer + position, data, size);
+        position += size;
+    }
+
+    uint8_t* data() const { return buffer; }
+    size_t size() const { return position; }
+    bool failed() const { return overflow; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t position;
+    bool overflow;
+};
+
+class StateReader {
+public:
+    StateReader(const uint8_t* buffer, size_t size) : buffer(buffer), length(size), position(0), overflow(false) {}
+
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "savestate fields must be plain data");
+        readBytes(&value, sizeof(T));
+    }
+
+    void readBytes(void* data, size_t size) {
+        if (overflow || size > length - position) {
+            overflow = true;
+            return;
+        }
+        std::memcpy(data, buffer + position, size);
+        position += size;
+    }
+
+    size_t remaining() const { return length - position; }
+    bool failed() const { return overflow; }
+
+private:
+    const uint8_t* buffer;
+    size_t length;
+    size_t position;
+    bool overflow;
+};
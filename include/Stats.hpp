@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <ostream>
+
+// counters for what the emulator spends its time on. they're only kept when built with
+// NES_STATS (make STATS=1), otherwise every STAT() compiles to nothing and they stay at zero
+#ifdef NES_STATS
+#define STAT(statement) do { statement; } while (0)
+#else
+#define STAT(statement) do { } while (0)
+#endif
+
+enum class BusRegion {
+    RAM,       // $0000-$1FFF
+    PPU,       // $2000-$3FFF
+    APU,       // $4000-$401F, the joypads included
+    UNMAPPED,  // $4020-$5FFF
+    PRG_RAM,   // $6000-$7FFF
+    PRG_ROM,   // $8000-$FFFF
+    COUNT
+};
+
+struct Stats {
+    static constexpr bool ENABLED =
+#ifdef NES_STATS
+        true;
+#else
+        false;
+#endif
+
+    uint64_t opcodes[256];
+    uint64_t busReads[static_cast<int>(BusRegion::COUNT)];
+    uint64_t busWrites[static_cast<int>(BusRegion::COUNT)];
+    // $2000-$2007, mirrors counted as the register they mirror
+    uint64_t ppuRegisterWrites[8];
+    uint64_t nmis;
+    uint64_t irqs;
+    uint64_t oamDmas;
+    uint64_t dmcDmas;
+    uint64_t framesRendered;
+
+    Stats();
+
+    void clear();
+
+    static BusRegion regionOf(uint16_t address);
+
+    // a readable summary, opcodes ordered from most to least executed
+    void dump(std::ostream& out) const;
+};
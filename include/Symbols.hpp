@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// names for CPU addresses, from ca65/ld65 debug info (ld65 --dbgfile) or label files (ld65 -Ln,
+// FCEUX .nl). files are only read the first time a name is looked up, so passing --symbols costs
+// nothing unless a trace or profile actually gets printed
+class Symbols {
+public:
+    // matches a symbol in any bank, and what symbols from label files get
+    static constexpr int ANY_BANK = -1;
+
+    Symbols();
+    ~Symbols();
+
+    // queues a .dbg or label file, the format is worked out from its contents. fails only if it
+    // can't be opened
+    bool add(const char* path);
+
+    // the name covering address as "name" or "name+offset", false if there isn't one. bank is
+    // the 16K PRG bank mapped at address; NROM never switches, so everything passes ANY_BANK
+    bool lookup(uint16_t address, std::string& name, int bank = ANY_BANK);
+
+    // the name, or address in hex with the given number of digits
+    std::string format(uint16_t address, int digits, int bank = ANY_BANK);
+
+    size_t size();
+
+private:
+    struct Symbol {
+        uint16_t start;
+        // one past the last address, so a symbol can end at $FFFF
+        uint32_t end;
+        int bank;
+        std::string name;
+    };
+
+    std::vector<std::string> pending;
+    // sorted by start address once everything pending is loaded
+    std::vector<Symbol> symbols;
+    // the furthest end of symbols[0..i], a lookup walks back from the last start at or below
+    // its address until nothing earlier can reach it
+    std::vector<uint32_t> maxEnd;
+
+    void load();
+    bool loadDbg(std::istream& file);
+    bool loadLabels(std::istream& file);
+};
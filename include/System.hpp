@@ -1,16 +1,30 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include <CPU.hpp>
 #include <Bus.hpp>
 #include <PPU.hpp>
 #include <APU.hpp>
 #include <Joypad.hpp>
+#include <Stats.hpp>
+
+// a finished frame, valid until the next call to System::runFrame
+struct FrameView {
+    const uint8_t* pixels;  // PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT palette indices
+    const int16_t* audio;
+    size_t audioSamples;
+    uint64_t frameNumber;
+};
 
 class System {
 public:
-    static System* instance;
+    // bump whenever any component changes what its saveState writes
+    static constexpr uint32_t SAVESTATE_VERSION = 4;
+    // comfortably above what the current layout writes, callers can keep one on the stack
+    static constexpr size_t SAVESTATE_SIZE = 16384;
+
     bool stop;
 
     CPU* cpu;
@@ -18,18 +32,57 @@ public:
     PPU* ppu;
     APU* apu;
     Joypad* joypad;
+    Joypad* joypad2;
 
     uint64_t masterCycles;
+    uint64_t frameCount;
+    uint64_t instructionCount;
+    // per opcode, bus region and so on, only counted in NES_STATS builds. not part of savestates
+    Stats stats;
+    System();
     System(std::string romPath);
+    ~System();
 
     void run();
 
     void step();
 
-    void stepThisAndPPU(uint8_t cycles);
+    FrameView runFrame();
+
+    // runs a frame for real, then emulates aheadFrames more with the same input, drawing only
+    // the last, and puts the machine back. the picture is that last frame, the audio the real one.
+    // the profiler and coverage map are detached for the frames run ahead and the counters are
+    // put back with the machine, so they only ever see the real frames
+    FrameView runFrameAhead(int aheadFrames);
+
+    // clocks the APU and PPU through cycles the CPU spends inside an instruction, like the
+    // interrupt sequence. true if the PPU wrapped past scanline 261, stepInstruction counts that
+    // frame as its own
+    bool stepThisAndPPU(uint8_t cycles);
+
+    // the console's reset button: the CPU jumps through the reset vector, the APU goes
+    // quiet and the PPU stops rendering and generating NMIs until the game sets it up again
+    void reset();
+    // switching the console off and on with the same cartridge in
+    void power();
 
     bool needsDraw();
 
+    // writes a versioned snapshot of the whole machine into buffer, returns the bytes used
+    // or 0 if it doesn't fit. neither call allocates
+    size_t saveState(uint8_t* buffer, size_t capacity) const;
+    // restores a snapshot taken from a machine running the same cartridge
+    bool loadState(const uint8_t* buffer, size_t size);
+
 private:
     bool draw;
+    // stepThisAndPPU finished a frame during the current instruction
+    bool frameDoneInside;
+
+    // the real frame's audio, runFrame clears the APU's buffer for every frame run ahead
+    std::vector<int16_t> aheadAudio;
+    // the real frame's counters, for the same reason
+    Stats realStats;
+
+    bool stepInstruction();
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include <string>
+
+#include <System.hpp>
+
+// blargg's test ROMs report through PRG RAM: $6001-$6003 hold DE B0 61 once the rest is valid,
+// $6000 is the status and a NUL terminated message starts at $6004
+class TestRom {
+public:
+    enum class Status {
+        WAITING,  // no signature yet, maybe not a test ROM at all
+        RUNNING,
+        PASSED,
+        FAILED
+    };
+
+    // the ROM asks for a reset at least 100ms after writing $81
+    static constexpr int RESET_DELAY_FRAMES = 10;
+
+    TestRom();
+
+    // call after every frame, presses reset when the ROM asks for one
+    Status update(System* system);
+
+    // the final status byte, 0 when passed and the failing test's number otherwise
+    uint8_t getResultCode() const;
+
+    static std::string readText(System* system);
+
+private:
+    Status status;
+    uint8_t resultCode;
+    int resetCountdown;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+// a fixed ring of timed scopes that write() turns into Chrome trace-event JSON, which
+// chrome://tracing and Perfetto open as is. nothing is recorded unless a Tracer is active, a
+// TRACE_SCOPE then costs one atomic load
+class Tracer {
+public:
+    // about six minutes at a dozen scopes a frame
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 18;
+
+    Tracer(size_t capacity = DEFAULT_CAPACITY);
+    ~Tracer();
+
+    // the tracer TRACE_SCOPE records into, nullptr stops recording
+    static void setActive(Tracer* tracer);
+    static Tracer* getActive();
+
+    // nanoseconds since the tracer was made
+    uint64_t now() const;
+
+    // name must outlive the tracer, in practice a string literal
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    // labels the calling thread's track in the viewer
+    void nameThread(const char* name);
+
+    // writes whatever the ring still holds, oldest first, and keeps recording
+    bool write(const char* path);
+
+private:
+    struct Event {
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+        uint32_t thread;
+    };
+
+    static constexpr uint32_t MAX_THREADS = 16;
+
+    static std::atomic<Tracer*> active;
+
+    Event* events;
+    size_t capacity;
+    size_t count;
+    size_t next;
+    const char* threadNames[MAX_THREADS];
+    std::chrono::steady_clock::time_point epoch;
+    std::mutex lock;
+};
+
+// records the time from its construction to the end of the enclosing block
+class TraceScope {
+public:
+    TraceScope(const char* name);
+    ~TraceScope();
+
+private:
+    Tracer* tracer;
+    const char* name;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
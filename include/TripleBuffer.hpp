@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// hands the newest value from one producer thread to one consumer thread without locking,
+// the producer never waits for the consumer and stale values are simply overwritten
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+    T& writeBuffer() {
+        return buffers[writeIndex];
+    }
+
+    // make the write buffer visible to the consumer and start writing into the old middle buffer
+    void publish() {
+        uint8_t previous = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+        writeIndex = previous & INDEX_MASK;
+    }
+
+    // returns true if a newer value was published since the last call
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    const T& readBuffer() const {
+        return buffers[readIndex];
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0b011;
+    static constexpr uint8_t FRESH = 0b100;
+
+    T buffers[3];
+
+    alignas(64) std::atomic<uint8_t> middle;
+    alignas(64) uint8_t writeIndex;
+    alignas(64) uint8_t readIndex;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <fstream>
+
+// streams 16-bit PCM to a .wav file, the header sizes are patched in on close
+class WavWriter {
+public:
+    WavWriter(const char* path, int sampleRate, int channels = 1);
+    ~WavWriter();
+
+    bool isOpen() const;
+
+    void write(const int16_t* samples, size_t count);
+    void close();
+
+    uint64_t getSampleCount() const;
+
+private:
+    void writeHeader();
+    void writeU16(uint16_t value);
+    void writeU32(uint32_t value);
+
+    std::ofstream file;
+    int sampleRate;
+    int channels;
+    uint64_t dataBytes;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+class StateWriter;
+class StateReader;
+
+// band-limited step synthesis: callers record amplitude changes at the clock cycle they happen,
+// each one is spread over a few output samples with a windowed sinc so nothing aliases, and
+// samples are only produced in bulk when a frame ends
+class BlipBuffer {
+public:
+    static constexpr int KERNEL_WIDTH = 16;
+    static constexpr int PHASE_BITS = 5;
+    static constexpr int PHASES = 1 << PHASE_BITS;
+    static constexpr int KERNEL_BITS = 12;
+    static constexpr int BASS_SHIFT = 9;
+    static constexpr size_t CAPACITY = 4096;
+
+    BlipBuffer();
+    ~BlipBuffer();
+
+    void setRates(double clockRate, double sampleRate);
+    void clear();
+
+    void addDelta(uint32_t clockTime, int32_t delta);
+
+    // makes the samples up to clockDuration available, later clock times are relative to it
+    void endFrame(uint32_t clockDuration);
+
+    size_t samplesAvailable() const;
+    size_t readSamples(int16_t* out, size_t count);
+
+    // saves the waveform as of clockTime: its level and the kernel tails still to come. output
+    // between the last read and clockTime is folded into the level, a loaded buffer starts there
+    void saveState(StateWriter& state, uint32_t clockTime) const;
+    void loadState(StateReader& state);
+
+private:
+    static int16_t kernel[PHASES][KERNEL_WIDTH];
+    static void buildKernel();
+
+    int32_t* buffer;
+    uint64_t factor;
+    uint64_t offset;
+    int32_t integrator;
+};
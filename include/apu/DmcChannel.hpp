@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+class Bus;
+class StateWriter;
+class StateReader;
+
+class DmcChannel {
+public:
+    DmcChannel();
+    ~DmcChannel();
+
+    void init();
+    void connectBus(Bus* bus);
+
+    void writeControl(uint8_t data);
+    void writeDirectLoad(uint8_t data);
+    void writeSampleAddress(uint8_t data);
+    void writeSampleLength(uint8_t data);
+
+    void setEnabled(bool enabled);
+    bool isActive() const;
+
+    // advances the output unit by the given number of CPU cycles
+    void run(uint32_t cycles);
+    // CPU cycles until the memory reader needs the next sample byte
+    uint32_t cyclesUntilFetch() const;
+
+    uint8_t output() const;
+
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
+    bool irqEnabled;
+    bool irqFlag;
+    bool loop;
+
+    // CPU cycles until the next timer reload
+    uint16_t currentTimer;
+    uint16_t timer;
+    uint8_t outputLevel;
+
+    uint16_t sampleAddress;
+    uint16_t sampleLength;
+    uint16_t currentAddress;
+    uint16_t bytesRemaining;
+
+    uint8_t sampleBuffer;
+    bool sampleBufferEmpty;
+    uint8_t shiftRegister;
+    uint8_t bitsRemaining;
+    bool silence;
+
+    // timer periods in CPU cycles
+    static const uint16_t rateTable[16];
+    static const uint16_t DMA_STALL_CYCLES = 4;
+
+private:
+    void restart();
+    void fetchSample();
+    void clockOutput();
+
+    Bus* bus;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+namespace apu {
+    // length counter load values indexed by the top 5 bits of $4003/$4007/$400B/$400F
+    extern const uint8_t lengthTable[32];
+}
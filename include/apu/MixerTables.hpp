@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include <array>
+
+// the console mixes the channels non-linearly, these are the lookup table approximations from
+// the NESdev wiki, pre-scaled to output amplitude and evaluated at compile time
+namespace apu {
+    constexpr double MIX_AMPLITUDE = 30000.0;
+
+    // indexed by pulse1 + pulse2
+    constexpr std::array<int32_t, 31> buildPulseTable() {
+        std::array<int32_t, 31> table = {};
+        for (int n = 1; n < 31; n++) {
+            table[n] = static_cast<int32_t>(95.52 / (8128.0 / n + 100.0) * MIX_AMPLITUDE + 0.5);
+        }
+        return table;
+    }
+
+    // indexed by 3 * triangle + 2 * noise + dmc
+    constexpr std::array<int32_t, 203> buildTndTable() {
+        std::array<int32_t, 203> table = {};
+        for (int n = 1; n < 203; n++) {
+            table[n] = static_cast<int32_t>(163.67 / (24329.0 / n + 100.0) * MIX_AMPLITUDE + 0.5);
+        }
+        return table;
+    }
+
+    inline constexpr std::array<int32_t, 31> pulseTable = buildPulseTable();
+    inline constexpr std::array<int32_t, 203> tndTable = buildTndTable();
+}
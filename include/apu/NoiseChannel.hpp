@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+class StateWriter;
+class StateReader;
+
+class NoiseChannel {
+public:
+    NoiseChannel();
+    ~NoiseChannel();
+
+    void init();
+    void writeVolume(uint8_t data);
+    void writePeriod(uint8_t data);
+    void writeLength(uint8_t length);
+
+    void setEnabled(bool enabled);
+
+    // advances the timer by the given number of CPU cycles
+    void run(uint32_t cycles);
+    uint32_t period() const;
+    // true while the output is stuck at 0 until the next register write or frame counter clock
+    bool idle() const;
+
+    void clockEnvelope();
+    void clockLength();
+
+    uint8_t output() const;
+
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
+    bool lengthTimerHalt;
+    bool constantVolume;
+    uint8_t volume;
+
+    bool mode;
+    // CPU cycles until the next timer reload
+    uint16_t currentTimer;
+    uint16_t timer;
+    uint8_t lengthCounter;
+    uint16_t shiftRegister;
+
+    // timer periods in CPU cycles
+    static const uint16_t periodTable[16];
+
+private:
+    bool enabled;
+
+    bool envelopeStart;
+    uint8_t envelopeDivider;
+    uint8_t envelopeDecay;
+};
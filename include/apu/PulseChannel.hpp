@@ -2,21 +2,44 @@
 
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class PulseChannel {
-    PulseChannel();
+public:
+    // pulse 1 negates its sweep with ones' complement, pulse 2 with two's complement
+    PulseChannel(bool onesComplementSweep);
     ~PulseChannel();
 
     void init();
     void writeDuty(uint8_t duty);
-    void writeSweep(uint8_t sweep); 
+    void writeSweep(uint8_t sweep);
     void writeTimerLow(uint8_t timerLow);
     void writeLength(uint8_t length);
 
+    void setEnabled(bool enabled);
+
+    // advances the timer by the given number of CPU cycles
+    void run(uint32_t cycles);
+    // CPU cycles between timer reloads
+    uint32_t period() const;
+    // true while the output is stuck at 0 until the next register write or frame counter clock
+    bool idle() const;
+
+    void clockEnvelope();
+    void clockLengthAndSweep();
+
+    uint8_t output() const;
+
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
     uint8_t dutyCycle;
     bool lengthTimerHalt;
     bool constantVolume;
     uint8_t volume;
 
+    // CPU cycles until the next timer reload
     uint16_t currentTimer;
     uint16_t timer;
     uint8_t lengthCounter;
@@ -28,4 +51,16 @@ class PulseChannel {
     uint8_t sweepShift;
 
     static const uint8_t dutyTable[4][8];
-};
\ No newline at end of file
+
+private:
+    uint16_t sweepTarget() const;
+
+    bool onesComplementSweep;
+    bool enabled;
+    uint8_t dutyStep;
+    bool sweepReload;
+
+    bool envelopeStart;
+    uint8_t envelopeDivider;
+    uint8_t envelopeDecay;
+};
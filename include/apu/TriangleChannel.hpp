@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+class StateWriter;
+class StateReader;
+
+class TriangleChannel {
+public:
+    TriangleChannel();
+    ~TriangleChannel();
+
+    void init();
+    void writeLinearCounter(uint8_t data);
+    void writeTimerLow(uint8_t timerLow);
+    void writeLength(uint8_t length);
+
+    void setEnabled(bool enabled);
+
+    // advances the timer by the given number of CPU cycles
+    void run(uint32_t cycles);
+    // CPU cycles between timer reloads
+    uint32_t period() const;
+    // true while the sequencer is halted and the output can't change
+    bool idle() const;
+
+    void clockLinearCounter();
+    void clockLength();
+
+    uint8_t output() const;
+
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
+    bool control;
+    uint8_t linearReload;
+    uint8_t linearCounter;
+    bool linearReloadFlag;
+
+    // CPU cycles until the next timer reload
+    uint16_t currentTimer;
+    uint16_t timer;
+    uint8_t lengthCounter;
+
+    static const uint8_t sequence[32];
+
+private:
+    bool enabled;
+    uint8_t sequenceStep;
+};
@@ -2,6 +2,9 @@
 
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class AddrRegister {
 public:
     AddrRegister();
@@ -11,6 +14,9 @@ public:
     void reset_latch();
     uint16_t get() const;
 
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
 private:
     void set(uint16_t data);
 
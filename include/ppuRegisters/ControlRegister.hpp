@@ -2,6 +2,9 @@
 
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class ControlRegister {
 public:
     static constexpr uint8_t NAMETABLE1              = 0b00000001;
@@ -24,6 +27,9 @@ public:
     bool generate_vblank_nmi() const;
     void update(uint8_t data);
 
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
 private:
     uint8_t bits;
     bool contains(uint8_t flag) const;
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstdint>
+
+class StateWriter;
+class StateReader;
 #include <vector>
 
 class MaskRegister {
@@ -26,6 +29,9 @@ public:
     bool emphasise_blue() const;
     void update(uint8_t data);
 
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
 private:
     uint8_t bits;
     bool contains(uint8_t flag) const;
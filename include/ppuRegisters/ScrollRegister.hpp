@@ -2,6 +2,9 @@
 
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class ScrollRegister {
 public:
     ScrollRegister();
@@ -12,6 +15,9 @@ public:
     uint8_t get_scroll_x() const { return scroll_x; }
     uint8_t get_scroll_y() const { return scroll_y; }
 
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
 private:
     uint8_t scroll_x;
     uint8_t scroll_y;
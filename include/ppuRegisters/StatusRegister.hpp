@@ -2,6 +2,9 @@
 
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class StatusRegister {
 public:
     static constexpr uint8_t NOTUSED          = 0b00000001;
@@ -25,6 +28,9 @@ public:
 
     uint8_t snapshot() const;
 
+    void saveState(StateWriter& state) const;
+    void loadState(StateReader& state);
+
 private:
     uint8_t bits;
 
@@ -1,13 +1,320 @@
 #include <APU.hpp>
+#include <apu/MixerTables.hpp>
+#include <SaveState.hpp>
 
-APU::APU() : status(0) {}
+#include <iostream>
+
+APU::APU() : pulse1(true), pulse2(false) {
+    fiveStepMode = false;
+    irqInhibit = false;
+    frameIrq = false;
+    frameCycle = 0;
+    time = 0;
+    targetTime = 0;
+    amplitude = 0;
+    blip.setRates(CPU_CLOCK, SAMPLE_RATE);
+    samples.reserve(SAMPLE_RATE / 30);
+    scheduleSync();
+}
 
 APU::~APU() {}
 
+void APU::connectBus(Bus* bus) {
+    dmc.connectBus(bus);
+}
+
+void APU::reset() {
+    run(targetTime);
+    pulse1.init();
+    pulse2.init();
+    triangle.init();
+    noise.init();
+    dmc.init();
+    fiveStepMode = false;
+    irqInhibit = false;
+    frameIrq = false;
+    frameCycle = 0;
+    updateOutput();
+    scheduleSync();
+}
+
+void APU::writeRegister(uint16_t address, uint8_t value) {
+    run(targetTime);
+    switch (address) {
+        case 0x4000: pulse1.writeDuty(value); break;
+        case 0x4001: pulse1.writeSweep(value); break;
+        case 0x4002: pulse1.writeTimerLow(value); break;
+        case 0x4003: pulse1.writeLength(value); break;
+        case 0x4004: pulse2.writeDuty(value); break;
+        case 0x4005: pulse2.writeSweep(value); break;
+        case 0x4006: pulse2.writeTimerLow(value); break;
+        case 0x4007: pulse2.writeLength(value); break;
+        case 0x4008: triangle.writeLinearCounter(value); break;
+        case 0x4009: break;
+        case 0x400A: triangle.writeTimerLow(value); break;
+        case 0x400B: triangle.writeLength(value); break;
+        case 0x400C: noise.writeVolume(value); break;
+        case 0x400D: break;
+        case 0x400E: noise.writePeriod(value); break;
+        case 0x400F: noise.writeLength(value); break;
+        case 0x4010: dmc.writeControl(value); break;
+        case 0x4011: dmc.writeDirectLoad(value); break;
+        case 0x4012: dmc.writeSampleAddress(value); break;
+        case 0x4013: dmc.writeSampleLength(value); break;
+        default:
+            std::cerr << "Invalid APU register: " << std::hex << address << std::endl;
+            break;
+    }
+    updateOutput();
+    scheduleSync();
+}
+
 void APU::writeStatus(uint8_t value) {
-    status = value;
+    run(targetTime);
+    pulse1.setEnabled(value & 0x01);
+    pulse2.setEnabled(value & 0x02);
+    triangle.setEnabled(value & 0x04);
+    noise.setEnabled(value & 0x08);
+    dmc.setEnabled(value & 0x10);
+    updateOutput();
+    scheduleSync();
 }
 
 uint8_t APU::readStatus() {
+    run(targetTime);
+    uint8_t status = 0;
+    status |= pulse1.lengthCounter > 0 ? 0x01 : 0;
+    status |= pulse2.lengthCounter > 0 ? 0x02 : 0;
+    status |= triangle.lengthCounter > 0 ? 0x04 : 0;
+    status |= noise.lengthCounter > 0 ? 0x08 : 0;
+    status |= dmc.isActive() ? 0x10 : 0;
+    status |= frameIrq ? 0x40 : 0;
+    status |= dmc.irqFlag ? 0x80 : 0;
+    frameIrq = false;
     return status;
-}
\ No newline at end of file
+}
+
+void APU::writeFrameCounter(uint8_t value) {
+    run(targetTime);
+    fiveStepMode = value & 0x80;
+    irqInhibit = value & 0x40;
+    if (irqInhibit) {
+        frameIrq = false;
+    }
+
+    frameCycle = 0;
+    if (fiveStepMode) {
+        clockQuarterFrame();
+        clockHalfFrame();
+        updateOutput();
+    }
+    scheduleSync();
+}
+
+void APU::tick(uint64_t cycles) {
+    targetTime += cycles;
+    if (targetTime >= syncTime) {
+        run(targetTime);
+        scheduleSync();
+    }
+    if (targetTime >= MAX_FRAME_CYCLES) {
+        endFrame();
+    }
+}
+
+void APU::endFrame() {
+    run(targetTime);
+    blip.endFrame(time);
+    time = 0;
+    targetTime = 0;
+    scheduleSync();
+
+    size_t count = samples.size();
+    samples.resize(count + blip.samplesAvailable());
+    blip.readSamples(samples.data() + count, samples.size() - count);
+}
+
+void APU::run(uint32_t end) {
+    while (time < end) {
+        uint32_t stepTime = time + (nextFrameCounterStep() - frameCycle);
+        uint32_t until = stepTime < end ? stepTime : end;
+        frameCycle += until - time;
+        runChannels(until);
+
+        if (until == stepTime) {
+            clockFrameCounter();
+            updateOutput();
+        }
+    }
+}
+
+// steps from one waveform edge to the next, so the cost follows the number of edges
+void APU::runChannels(uint32_t end) {
+    while (time < end) {
+        uint32_t cycles = end - time;
+        if (!pulse1.idle() && pulse1.currentTimer < cycles) {
+            cycles = pulse1.currentTimer;
+        }
+        if (!pulse2.idle() && pulse2.currentTimer < cycles) {
+            cycles = pulse2.currentTimer;
+        }
+        if (!triangle.idle() && triangle.currentTimer < cycles) {
+            cycles = triangle.currentTimer;
+        }
+        if (!noise.idle() && noise.currentTimer < cycles) {
+            cycles = noise.currentTimer;
+        }
+        if (dmc.currentTimer < cycles) {
+            cycles = dmc.currentTimer;
+        }
+
+        pulse1.run(cycles);
+        pulse2.run(cycles);
+        triangle.run(cycles);
+        noise.run(cycles);
+        dmc.run(cycles);
+        time += cycles;
+
+        updateOutput();
+    }
+}
+
+// the next point the CPU could notice: a frame counter step (IRQ) or a DMC fetch
+void APU::scheduleSync() {
+    syncTime = time + (nextFrameCounterStep() - frameCycle);
+    uint32_t fetch = dmc.cyclesUntilFetch();
+    if (fetch != UINT32_MAX && time + fetch < syncTime) {
+        syncTime = time + fetch;
+    }
+}
+
+uint16_t APU::nextFrameCounterStep() const {
+    static const uint16_t fourStep[] = { 7457, 14913, 22371, 29829, 29830 };
+    static const uint16_t fiveStep[] = { 7457, 14913, 22371, 37281, 37282 };
+    const uint16_t* steps = fiveStepMode ? fiveStep : fourStep;
+    for (int i = 0; i < 5; i++) {
+        if (steps[i] > frameCycle) {
+            return steps[i];
+        }
+    }
+    return steps[4];
+}
+
+// sequencer steps in CPU cycles, 4-step mode repeats every 29830 and 5-step every 37282
+void APU::clockFrameCounter() {
+    switch (frameCycle) {
+        case 7457:
+        case 22371:
+            clockQuarterFrame();
+            break;
+        case 14913:
+            clockQuarterFrame();
+            clockHalfFrame();
+            break;
+        case 29829:
+            if (!fiveStepMode) {
+                clockQuarterFrame();
+                clockHalfFrame();
+                if (!irqInhibit) {
+                    frameIrq = true;
+                }
+            }
+            break;
+        case 29830:
+            if (!fiveStepMode) {
+                frameCycle = 0;
+            }
+            break;
+        case 37281:
+            clockQuarterFrame();
+            clockHalfFrame();
+            break;
+        case 37282:
+            frameCycle = 0;
+            break;
+    }
+}
+
+void APU::clockQuarterFrame() {
+    pulse1.clockEnvelope();
+    pulse2.clockEnvelope();
+    triangle.clockLinearCounter();
+    noise.clockEnvelope();
+}
+
+void APU::clockHalfFrame() {
+    pulse1.clockLengthAndSweep();
+    pulse2.clockLengthAndSweep();
+    triangle.clockLength();
+    noise.clockLength();
+}
+
+bool APU::pollIrq() const {
+    return frameIrq || dmc.irqFlag;
+}
+
+void APU::setSampleRateAdjust(double ratio) {
+    blip.setRates(CPU_CLOCK, SAMPLE_RATE * ratio);
+}
+
+int32_t APU::mix() const {
+    return apu::pulseTable[pulse1.output() + pulse2.output()] + apu::tndTable[3 * triangle.output() + 2 * noise.output() + dmc.output()];
+}
+
+void APU::updateOutput() {
+    int32_t output = mix();
+    if (output != amplitude) {
+        blip.addDelta(time, output - amplitude);
+        amplitude = output;
+    }
+}
+
+const int16_t* APU::getSamples() const {
+    return samples.data();
+}
+
+size_t APU::getSampleCount() const {
+    return samples.size();
+}
+
+void APU::clearSamples() {
+    samples.clear();
+}
+
+void APU::saveState(StateWriter& state) const {
+    pulse1.saveState(state);
+    pulse2.saveState(state);
+    triangle.saveState(state);
+    noise.saveState(state);
+    dmc.saveState(state);
+    state.write(fiveStepMode);
+    state.write(irqInhibit);
+    state.write(frameIrq);
+    state.write(frameCycle);
+    state.write(time);
+    state.write(targetTime);
+    state.write(amplitude);
+    blip.saveState(state, time);
+}
+
+void APU::loadState(StateReader& state) {
+    pulse1.loadState(state);
+    pulse2.loadState(state);
+    triangle.loadState(state);
+    noise.loadState(state);
+    dmc.loadState(state);
+    state.read(fiveStepMode);
+    state.read(irqInhibit);
+    state.read(frameIrq);
+    state.read(frameCycle);
+    state.read(time);
+    state.read(targetTime);
+    state.read(amplitude);
+    blip.loadState(state);
+
+    // the blip buffer resumes at the saved time, so that is where the output frame restarts
+    targetTime -= time;
+    time = 0;
+    samples.clear();
+    scheduleSync();
+}
@@ -68,36 +68,84 @@
 // }
 
 #include <Bus.hpp>
+#include <SaveState.hpp>
+#include <Coverage.hpp>
 #include <iostream>
 
 #define RAM 0x0000
 #define RAM_MIRRORS_END 0x1FFF
 #define PPU_REGISTERS 0x2000
 #define PPU_REGISTERS_MIRRORS_END 0x3FFF
+#define PRG_RAM 0x6000
+#define PRG_RAM_END 0x7FFF
+#define PRG_RAM_SIZE 0x2000
 
-Bus::Bus(PPU* ppu, APU* apu, Joypad* joypad) {
+Bus::Bus(PPU* ppu, APU* apu, Joypad* joypad, Joypad* joypad2, Stats* stats) {
     cpuMemory = new uint8_t[2048];
-    prgMemory = new uint8_t[0xFFFF-0x8000];
+    prgMemory = new uint8_t[0x8000];
+    prgRam = new uint8_t[PRG_RAM_SIZE];
     this->ppu = ppu;
     this->apu = apu;
     this->joypad = joypad;
+    this->joypad2 = joypad2;
+    this->stats = stats;
+    coverage = nullptr;
+    stallCycles = 0;
 }   
 
 Bus::~Bus() {
     delete[] cpuMemory;
     delete[] prgMemory;
+    delete[] prgRam;
 }
 
 void Bus::Zero() {
     for (int i = 0; i < 0x0800; i++) {
         cpuMemory[i] = 0;
     }
-    for (int i = 0; i < 0xFFFF-0x8000; i++) {
+    for (int i = 0; i < 0x8000; i++) {
         prgMemory[i] = 0;
     }
+    for (int i = 0; i < PRG_RAM_SIZE; i++) {
+        prgRam[i] = 0;
+    }
+}
+
+void Bus::clearRam() {
+    for (int i = 0; i < 0x0800; i++) {
+        cpuMemory[i] = 0;
+    }
+    stallCycles = 0;
 }
 
 uint8_t Bus::read(uint16_t address) {
+    return read(address, Coverage::READ);
+}
+
+uint8_t Bus::fetch(uint16_t address) {
+    return read(address, Coverage::EXECUTED);
+}
+
+uint8_t Bus::peek(uint16_t address) const {
+    if (address >= RAM && address <= RAM_MIRRORS_END) {
+        return cpuMemory[address & 0x07FF];
+    } else if (address >= PRG_RAM && address <= PRG_RAM_END) {
+        return prgRam[address - PRG_RAM];
+    } else if (address >= 0x8000) {
+        return prgMemory[address - 0x8000];
+    }
+    return 0;
+}
+
+uint8_t Bus::read(uint16_t address, uint8_t coverageFlag) {
+    if (address >= 0x2008 && address <= PPU_REGISTERS_MIRRORS_END) {
+        address &= 0x2007;
+    }
+    STAT(stats->busReads[static_cast<int>(Stats::regionOf(address))]++);
+    if (coverage != nullptr) {
+        coverage->mark(address, coverageFlag);
+    }
+
     if (address >= RAM && address <= RAM_MIRRORS_END) {
         return cpuMemory[address & 0x07FF];
     } else if (address == 0x2000 || address == 0x2001 || address == 0x2003 || address == 0x2005 || address == 0x2006 || address == 0x4014) {
@@ -108,13 +156,14 @@ uint8_t Bus::read(uint16_t address) {
         return ppu->readFromOamData();
     } else if (address == 0x2007) {
         return ppu->readFromDataRegister();
-    } else if (address >= 0x2008 && address <= PPU_REGISTERS_MIRRORS_END) {
-        uint16_t mirrorDown = address & 0x2007;
-        return read(mirrorDown);
     } else if (address == 0x4015) {
         return apu->readStatus();
     } else if (address == 0x4016) {
         return joypad->read();
+    } else if (address == 0x4017) {
+        return joypad2->read();
+    } else if (address >= PRG_RAM && address <= PRG_RAM_END) {
+        return prgRam[address - PRG_RAM];
     } else if (address >= 0x8000 && address <= 0xFFFF) {
         return prgMemory[address - 0x8000];
     } else {
@@ -130,6 +179,16 @@ uint16_t Bus::readWord(uint16_t address) {
 
 
 void Bus::write(uint16_t address, uint8_t data) {
+    // the mirrors are folded first so they count as the register they reach
+    if (address >= 0x2008 && address <= PPU_REGISTERS_MIRRORS_END) {
+        address &= 0x2007;
+    }
+    STAT(stats->busWrites[static_cast<int>(Stats::regionOf(address))]++);
+    STAT(if (address >= PPU_REGISTERS && address < 0x2008) stats->ppuRegisterWrites[address & 0x07]++);
+    if (coverage != nullptr) {
+        coverage->mark(address, Coverage::WRITTEN);
+    }
+
     if (address >= RAM && address <= RAM_MIRRORS_END) {
         cpuMemory[address & 0x07FF] = data;
     } else if (address == 0x2000) {
@@ -155,13 +214,20 @@ void Bus::write(uint16_t address, uint8_t data) {
             buffer[i] = read(hi + i);
         }
         ppu->writeToOamDma(buffer);
-    } else if (address >= 0x2008 && address <= PPU_REGISTERS_MIRRORS_END) {
-        uint16_t mirrorDown = address & 0x2007;
-        write(mirrorDown, data);
+        stall(513);
+        STAT(stats->oamDmas++);
+    } else if (address >= 0x4000 && address <= 0x4013) {
+        apu->writeRegister(address, data);
     } else if (address == 0x4015) {
         apu->writeStatus(data);
     } else if (address == 0x4016) {
+        // the strobe line goes to both ports
         joypad->write(data);
+        joypad2->write(data);
+    } else if (address == 0x4017) {
+        apu->writeFrameCounter(data);
+    } else if (address >= PRG_RAM && address <= PRG_RAM_END) {
+        prgRam[address - PRG_RAM] = data;
     } else if (address >= 0x8000 && address <= 0xFFFF) {
         prgMemory[address - 0x8000] = data;
     } else {
@@ -184,6 +250,32 @@ void Bus::tickPPU(uint8_t cycles) {
     ppu->tick(cycles);
 }
 
+void Bus::stall(uint16_t cycles) {
+    stallCycles += cycles;
+}
+
+uint16_t Bus::takeStallCycles() {
+    uint16_t cycles = stallCycles;
+    stallCycles = 0;
+    return cycles;
+}
+
 bool Bus::pollNmiStatus() {
     return ppu->pollNmiInterrupt();
 }
+
+bool Bus::pollIrqStatus() {
+    return apu->pollIrq();
+}
+
+void Bus::saveState(StateWriter& state) const {
+    state.writeBytes(cpuMemory, 0x0800);
+    state.writeBytes(prgRam, PRG_RAM_SIZE);
+    state.write(stallCycles);
+}
+
+void Bus::loadState(StateReader& state) {
+    state.readBytes(cpuMemory, 0x0800);
+    state.readBytes(prgRam, PRG_RAM_SIZE);
+    state.read(stallCycles);
+}
@@ -1,13 +1,20 @@
 #include <CPU.hpp>
 
 #include <System.hpp>
+#include <SaveState.hpp>
+#include <Profiler.hpp>
+#include <Symbols.hpp>
 
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 
-CPU::CPU(Bus* memory) {
+CPU::CPU(Bus* memory, System* system) {
     this->memory = memory;
+    this->system = system;
+    this->logging = true;
+    this->profiler = nullptr;
+    this->symbols = nullptr;
 }
 
 void CPU::powerOn() {
@@ -29,6 +36,9 @@ void CPU::powerOn() {
     miscValue = 0;
     stepCountAfterFatalError = 0;
     pageCrossed = false;
+    if (profiler != nullptr) {
+        profiler->resetStack();
+    }
 }
 
 void CPU::reset() {
@@ -37,12 +47,43 @@ void CPU::reset() {
     flags = 0x24;
     cycles = 4;
     pageCrossed = false;
+    if (profiler != nullptr) {
+        profiler->resetStack();
+    }
 }
 
 size_t CPU::getCycles() {
     return cycles;
 }
 
+void CPU::stall(uint16_t cycles) {
+    this->cycles += cycles;
+    // DMA is started by the instruction that just ran, charge it to the same routine
+    if (profiler != nullptr) {
+        profiler->addCycles(cycles);
+    }
+}
+
+void CPU::saveState(StateWriter& state) const {
+    state.write(programCounter);
+    state.write(accumulator);
+    state.write(xIndex);
+    state.write(yIndex);
+    state.write(stackPointer);
+    state.write(flags);
+    state.write(cycles);
+}
+
+void CPU::loadState(StateReader& state) {
+    state.read(programCounter);
+    state.read(accumulator);
+    state.read(xIndex);
+    state.read(yIndex);
+    state.read(stackPointer);
+    state.read(flags);
+    state.read(cycles);
+}
+
 uint8_t CPU::getCarry() {
     return (flags & 0x01) >> 0;
 }
@@ -129,13 +170,13 @@ uint16_t CPU::popWord() {
 }
 
 uint8_t CPU::fetch() {
-    uint8_t data = memory->read(programCounter++);
+    uint8_t data = memory->fetch(programCounter++);
     fetchLogs.push_back(data);
     return data;
 }
 
 uint16_t CPU::fetchWord() {
-    uint16_t data = memory->readWord(programCounter);
+    uint16_t data = memory->fetch(programCounter) | (memory->fetch(programCounter + 1) << 8);
     programCounter += 2;
     fetchLogs.push_back(data & 0xFF);
     fetchLogs.push_back(data >> 8);
@@ -151,7 +192,7 @@ uint16_t CPU::fetchWordNoAdvance() {
 }
 
 void CPU::stepTo(uint64_t cycle) {
-    while (cycles < cycle && !System::instance->stop) {
+    while (cycles < cycle && !system->stop) {
         execOnce();
     }
 }
@@ -282,6 +323,15 @@ uint16_t CPU::getAddress(AddressingMode mode) {
     return 0;
 }
 
+std::string CPU::formatAddress(uint16_t address, int digits) {
+    if (symbols != nullptr) {
+        return symbols->format(address, digits);
+    }
+    std::stringstream ss;
+    ss << "$" << std::uppercase << std::hex << std::setw(digits) << std::setfill('0') << (int)address;
+    return ss.str();
+}
+
 std::string CPU::getAddressWithMode(AddressingMode mode) {
     std::stringstream ss;
     ss << std::uppercase;
@@ -295,34 +345,34 @@ std::string CPU::getAddressWithMode(AddressingMode mode) {
             ss << "#$" << std::hex << std::setw(2) << std::setfill('0') << (int)fetchLogs[1];
             break;
         case AddressingMode::ZP0:
-            ss << "$" << std::hex << std::setw(2) << std::setfill('0') << (int)fetchLogs[1];
+            ss << formatAddress(fetchLogs[1], 2);
             break;
         case AddressingMode::ZPX:
-            ss << "$" << std::hex << std::setw(2) << std::setfill('0') << (int)fetchLogs[1] << ",X";
+            ss << formatAddress(fetchLogs[1], 2) << ",X";
             break;
         case AddressingMode::ZPY:
-            ss << "$" << std::hex << std::setw(2) << std::setfill('0') << (int)fetchLogs[1] << ",Y";
+            ss << formatAddress(fetchLogs[1], 2) << ",Y";
             break;
         case AddressingMode::REL:
-            ss << "$" << std::hex << std::setw(4) << std::setfill('0') << (int)branchLocation;
+            ss << formatAddress(branchLocation, 4);
             break;
         case AddressingMode::ABS:
-            ss << "$" << std::hex << std::setw(4) << std::setfill('0') << (int)fetchLogs[1] + (fetchLogs[2] << 8);
+            ss << formatAddress(fetchLogs[1] + (fetchLogs[2] << 8), 4);
             break;
         case AddressingMode::ABX:
-            ss << "$" << std::hex << std::setw(4) << std::setfill('0') << (int)fetchLogs[1] + (fetchLogs[2] << 8) << ",X";
+            ss << formatAddress(fetchLogs[1] + (fetchLogs[2] << 8), 4) << ",X";
             break;
         case AddressingMode::ABY:
-            ss << "$" << std::hex << std::setw(4) << std::setfill('0') << (int)fetchLogs[1] + (fetchLogs[2] << 8) << ",Y";
+            ss << formatAddress(fetchLogs[1] + (fetchLogs[2] << 8), 4) << ",Y";
             break;
         case AddressingMode::IND:
-            ss << "($" << std::hex << std::setw(4) << std::setfill('0') << (int)fetchLogs[1] + (fetchLogs[2] << 8) << ")";
+            ss << "(" << formatAddress(fetchLogs[1] + (fetchLogs[2] << 8), 4) << ")";
             break;
         case AddressingMode::IZX:
-            ss << "($" << std::hex << std::setw(2) << std::setfill('0') << (int)fetchLogs[1] << ",X)";
+            ss << "(" << formatAddress(fetchLogs[1], 2) << ",X)";
             break;
         case AddressingMode::IZY:
-            ss << "($" << std::hex << std::setw(2) << std::setfill('0') << (int)fetchLogs[1] << "),Y";
+            ss << "(" << formatAddress(fetchLogs[1], 2) << "),Y";
             break;
         case AddressingMode::NOP:
             break;
@@ -1646,21 +1696,37 @@ void CPU::interrupt(const interrupt::Interrupt& interrupt) {
     setIFlag((interrupt.b_flag_mask & 0b100000) == 0b100000);
     pushByte(flag);
     setInterruptDisable(true);
-    System::instance->stepThisAndPPU(interrupt.cpu_cycles);
+    system->stepThisAndPPU(interrupt.cpu_cycles);
     programCounter = memory->readWord(interrupt.vector_addr);
 }
 
 void CPU::execOnce() {
     fetchLogs.clear();
-    if (System::instance->stop) {
+    if (system->stop) {
         return;
     }
 
+    size_t cyclesBefore = cycles;
+
+    // the interrupt sequence pushes 3 bytes, its cycles are clocked straight into the PPU and APU
     if (bool nmiStatus = memory->pollNmiStatus(); nmiStatus) {
         interrupt(interrupt::NMI);
+        STAT(system->stats.nmis++);
+        if (profiler != nullptr) {
+            profiler->call(programCounter, stackPointer + 3, CallKind::NMI);
+            profiler->addCycles(interrupt::NMI.cpu_cycles);
+        }
+    } else if (!getInterruptDisable() && memory->pollIrqStatus()) {
+        interrupt(interrupt::IRQ);
+        STAT(system->stats.irqs++);
+        if (profiler != nullptr) {
+            profiler->call(programCounter, stackPointer + 3, CallKind::IRQ);
+            profiler->addCycles(interrupt::IRQ.cpu_cycles);
+        }
     }
 
     uint8_t opcode = fetch();
+    STAT(system->stats.opcodes[opcode]++);
 
     switch (opcode) {
         case 0x00: // BRK
@@ -1681,7 +1747,7 @@ void CPU::execOnce() {
             break;
 
         case 0x02: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x03: // Illegal *SLO Indexed, Indirect
@@ -1832,7 +1898,7 @@ void CPU::execOnce() {
             break;
 
         case 0x12: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
             
         case 0x13: // Illegal *SLO (Indirect), Y
@@ -1980,7 +2046,7 @@ void CPU::execOnce() {
             break;
 
         case 0x22: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x23: // Illegal *RLA (Indirect,X)
@@ -2149,7 +2215,7 @@ void CPU::execOnce() {
             break;
 
         case 0x32: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x33: // Illegal *RLA (Indirect),Y
@@ -2313,7 +2379,7 @@ void CPU::execOnce() {
             break;
 
         case 0x42: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x43: // Illegal *SRE Indexed, Indirect
@@ -2469,7 +2535,7 @@ void CPU::execOnce() {
             break;
 
         case 0x52: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x53: // Illegal *SRE Indirect, Indexed
@@ -2625,7 +2691,7 @@ void CPU::execOnce() {
             break;
 
         case 0x62: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x63: // Illegal *RRA Indexed, Indirect
@@ -2832,7 +2898,7 @@ void CPU::execOnce() {
             break;
 
         case 0x72: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x73: // Illegal *RRA Indirect, Indexed
@@ -3124,7 +3190,7 @@ void CPU::execOnce() {
             break;
 
         case 0x92: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0x93: // Illegal SHA Indirect, Indexed
@@ -3376,7 +3442,7 @@ void CPU::execOnce() {
             break;
 
         case 0xB2: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0xB3: // Illegal LAX Indirect, Indexed
@@ -3684,7 +3750,7 @@ void CPU::execOnce() {
             break;
 
         case 0xD2: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0xD3: // Illegal *DCP Indirect, Indexed
@@ -4024,7 +4090,7 @@ void CPU::execOnce() {
             break;
 
         case 0xF2: // Illegal KIL
-            System::instance->stop = true;
+            system->stop = true;
             break;
 
         case 0xF3: // Illegal *ISB Indirect, Indexed
@@ -4171,10 +4237,24 @@ void CPU::execOnce() {
             break;
         
         default:
-            std::cout << "Opcode not implemented: " << std::hex << (int)opcode << std::endl;
-            System::instance->stop = true;
+            std::cerr << "Opcode not implemented: " << std::hex << (int)opcode << std::dec << std::endl;
+            system->stop = true;
             break;
     }
 
-    std::cout << log() << std::endl;
+    // the call itself is charged to the caller and the return to the routine returning
+    if (profiler != nullptr) {
+        profiler->addCycles(cycles - cyclesBefore);
+        if (opcode == 0x20) {
+            profiler->call(programCounter, stackPointer + 2, CallKind::JSR);
+        } else if (opcode == 0x00) {
+            profiler->call(programCounter, stackPointer + 3, CallKind::BRK);
+        } else if (opcode == 0x60 || opcode == 0x40) {
+            profiler->ret(stackPointer);
+        }
+    }
+
+    if (logging) {
+        std::cout << log() << std::endl;
+    }
 }
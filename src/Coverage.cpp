@@ -0,0 +1,142 @@
+#include <Coverage.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#define RAM_SIZE 0x0800
+#define RAM_MIRRORS_END 0x1FFF
+#define PRG_RAM 0x6000
+#define PRG_RAM_SIZE 0x2000
+#define PRG_ROM 0x8000
+#define PRG_WINDOW_SIZE 0x8000
+
+// FCEUX code/data log bits for a PRG byte
+#define CDL_CODE 0x01
+#define CDL_DATA 0x02
+#define CDL_PCM 0x40
+
+Coverage::Coverage(size_t prgSize, size_t chrSize) {
+    map = new uint8_t[0x10000];
+    this->prgSize = prgSize;
+    this->chrSize = chrSize;
+    clear();
+}
+
+Coverage::~Coverage() {
+    delete[] map;
+}
+
+void Coverage::clear() {
+    for (int i = 0; i < 0x10000; i++) {
+        map[i] = 0;
+    }
+}
+
+uint8_t Coverage::prgFlags(size_t offset) const {
+    uint8_t flags = 0;
+    if (prgSize == 0 || offset >= PRG_WINDOW_SIZE) {
+        return flags;
+    }
+    // a 16K ROM shows up at both $8000 and $C000
+    for (size_t address = PRG_ROM + offset; address < 0x10000; address += prgSize) {
+        flags |= map[address];
+    }
+    return flags;
+}
+
+bool Coverage::writeMap(const char* path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not write coverage: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> out(RAM_SIZE + PRG_RAM_SIZE + prgSize, 0);
+    for (int address = 0; address <= RAM_MIRRORS_END; address++) {
+        out[address & (RAM_SIZE - 1)] |= map[address];
+    }
+    for (int i = 0; i < PRG_RAM_SIZE; i++) {
+        out[RAM_SIZE + i] = map[PRG_RAM + i];
+    }
+    for (size_t i = 0; i < prgSize; i++) {
+        out[RAM_SIZE + PRG_RAM_SIZE + i] = prgFlags(i);
+    }
+
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    return file.good();
+}
+
+bool Coverage::writeCdl(const char* path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not write coverage: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> out(prgSize + chrSize, 0);
+    for (size_t i = 0; i < prgSize && i < PRG_WINDOW_SIZE; i++) {
+        for (size_t address = PRG_ROM + i; address < 0x10000; address += prgSize) {
+            uint8_t flags = map[address];
+            if (flags == 0) {
+                continue;
+            }
+            // bits 2-3 say which 8K window of $8000-$FFFF the byte was used through. fetches
+            // don't count as reads, so a byte is data only if something read it as data
+            uint8_t cdl = ((address >> 13) & 0x03) << 2;
+            if (flags & EXECUTED) {
+                cdl |= CDL_CODE;
+            }
+            if (flags & READ) {
+                cdl |= CDL_DATA;
+            }
+            if (flags & SAMPLE) {
+                cdl |= CDL_DATA | CDL_PCM;
+            }
+            out[i] |= cdl;
+        }
+    }
+
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    return file.good();
+}
+
+bool Coverage::write(const char* path) const {
+    std::string name = path;
+    if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".cdl") == 0) {
+        return writeCdl(path);
+    }
+    return writeMap(path);
+}
+
+void Coverage::summary(std::ostream& out) const {
+    size_t ramRead = 0;
+    size_t ramWritten = 0;
+    for (int i = 0; i < RAM_SIZE; i++) {
+        uint8_t flags = 0;
+        for (int address = i; address <= RAM_MIRRORS_END; address += RAM_SIZE) {
+            flags |= map[address];
+        }
+        ramRead += (flags & READ) != 0;
+        ramWritten += (flags & WRITTEN) != 0;
+    }
+
+    size_t executed = 0;
+    size_t data = 0;
+    for (size_t i = 0; i < prgSize; i++) {
+        uint8_t flags = prgFlags(i);
+        executed += (flags & EXECUTED) != 0;
+        data += (flags & (READ | SAMPLE)) != 0;
+    }
+
+    out << "coverage: RAM " << ramRead << " of " << RAM_SIZE << " bytes read, " << ramWritten << " written; PRG ROM "
+        << executed << " of " << prgSize << " bytes executed";
+    if (prgSize > 0) {
+        std::streamsize precision = out.precision();
+        out << " (" << std::fixed << std::setprecision(1) << 100.0 * executed / prgSize << "%)" << std::defaultfloat
+            << std::setprecision(precision);
+    }
+    out << ", " << data << " read as data" << std::endl;
+}
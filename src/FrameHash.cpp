@@ -0,0 +1,21 @@
+#include <FrameHash.hpp>
+
+FrameHash::FrameHash() {
+    video = FNV_OFFSET_BASIS;
+    audio = FNV_OFFSET_BASIS;
+}
+
+void FrameHash::add(const FrameView& view) {
+    // the NSF player has no picture, its video hash stays at the basis
+    if (view.pixels != nullptr) {
+        video = Movie::hashBytes(video, view.pixels, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT);
+    }
+
+    for (size_t i = 0; i < view.audioSamples; i++) {
+        uint8_t bytes[2] = {
+            static_cast<uint8_t>(view.audio[i] & 0xFF),
+            static_cast<uint8_t>((view.audio[i] >> 8) & 0xFF)
+        };
+        audio = Movie::hashBytes(audio, bytes, sizeof(bytes));
+    }
+}
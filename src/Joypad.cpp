@@ -1,4 +1,5 @@
 #include <Joypad.hpp>
+#include <SaveState.hpp>
 
 Joypad::Joypad() {
     joypadState = 0;
@@ -34,3 +35,21 @@ void Joypad::setButtonState(uint8_t button, bool pressed) {
         joypadState &= ~button;
     }
 }
+
+void Joypad::setState(uint8_t buttons) {
+    joypadState = buttons;
+}
+
+uint8_t Joypad::getState() const {
+    return joypadState;
+}
+
+void Joypad::saveState(StateWriter& state) const {
+    state.write(buttonIndex);
+    state.write(strobe);
+}
+
+void Joypad::loadState(StateReader& state) {
+    state.read(buttonIndex);
+    state.read(strobe);
+}
@@ -0,0 +1,162 @@
+#include <Lz.hpp>
+
+#include <cstring>
+
+namespace {
+    constexpr int HASH_BITS = 12;
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t MAX_OFFSET = 0xFFFF;
+
+    uint32_t read32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t value) {
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // lengths that don't fit the token's nibble continue in 255 valued bytes
+    bool writeLength(uint8_t*& op, const uint8_t* end, size_t length) {
+        while (length >= 255) {
+            if (op == end) {
+                return false;
+            }
+            *op++ = 255;
+            length -= 255;
+        }
+        if (op == end) {
+            return false;
+        }
+        *op++ = static_cast<uint8_t>(length);
+        return true;
+    }
+
+    bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip == end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // one literal run followed by a match, or just the literals when matchLength is 0
+    bool writeSequence(uint8_t*& op, const uint8_t* end, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+        if (op == end) {
+            return false;
+        }
+        size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+        *token |= static_cast<uint8_t>(matchCode < 15 ? matchCode : 15);
+
+        if (literalLength >= 15 && !writeLength(op, end, literalLength - 15)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - op) < literalLength) {
+            return false;
+        }
+        std::memcpy(op, literals, literalLength);
+        op += literalLength;
+
+        if (matchLength == 0) {
+            return true;
+        }
+        if (end - op < 2) {
+            return false;
+        }
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        return matchCode < 15 || writeLength(op, end, matchCode - 15);
+    }
+}
+
+size_t lz::compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+    uint32_t table[1 << HASH_BITS];
+    std::memset(table, 0, sizeof(table));
+
+    uint8_t* op = dst;
+    const uint8_t* end = dst + capacity;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    while (ip + MIN_MATCH <= size) {
+        uint32_t value = read32(src + ip);
+        uint32_t& slot = table[hash(value)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(ip);
+
+        if (candidate >= ip || ip - candidate > MAX_OFFSET || read32(src + candidate) != value) {
+            ip++;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (ip + length < size && src[candidate + length] == src[ip + length]) {
+            length++;
+        }
+        if (!writeSequence(op, end, src + anchor, ip - anchor, ip - candidate, length)) {
+            return 0;
+        }
+        ip += length;
+        anchor = ip;
+    }
+
+    if (!writeSequence(op, end, src + anchor, size - anchor, 0, 0)) {
+        return 0;
+    }
+    return op - dst;
+}
+
+size_t lz::decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+    const uint8_t* ip = src;
+    const uint8_t* ipEnd = src + size;
+    size_t op = 0;
+
+    while (ip < ipEnd) {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, ipEnd, literalLength)) {
+            return 0;
+        }
+        if (static_cast<size_t>(ipEnd - ip) < literalLength || capacity - op < literalLength) {
+            return 0;
+        }
+        std::memcpy(dst + op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // the last sequence has no match
+        if (ip == ipEnd) {
+            break;
+        }
+
+        if (ipEnd - ip < 2) {
+            return 0;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(ip, ipEnd, matchLength)) {
+            return 0;
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > op || capacity - op < matchLength) {
+            return 0;
+        }
+
+        // byte by byte, matches may overlap their own output
+        for (size_t i = 0; i < matchLength; i++) {
+            dst[op + i] = dst[op - offset + i];
+        }
+        op += matchLength;
+    }
+
+    return op;
+}
@@ -0,0 +1,236 @@
+#include <Movie.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+
+static const char MOVIE_MAGIC[4] = {'N', 'M', 'O', 'V'};
+
+// header: magic, version, ROM hash and frame count, all little endian, then 3 bytes a frame
+#define MOVIE_HEADER_SIZE 20
+// commands, then joypad 1 and joypad 2
+#define MOVIE_FRAME_SIZE 3
+
+static void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (i * 8)) & 0xFF;
+    }
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+Movie::Movie() {
+    romHash = 0;
+}
+
+Movie::~Movie() {
+}
+
+bool Movie::load(const char* path) {
+    size_t length = std::strlen(path);
+    if (length >= 4 && std::strcmp(path + length - 4, ".fm2") == 0) {
+        return loadFm2(path);
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open movie: " << path << std::endl;
+        return false;
+    }
+
+    uint8_t header[MOVIE_HEADER_SIZE];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file.good() || std::memcmp(header, MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) != 0) {
+        std::cerr << "Not a movie file: " << path << std::endl;
+        return false;
+    }
+    if (getU32(header + 4) != VERSION) {
+        std::cerr << "Movie version " << getU32(header + 4) << " is not supported" << std::endl;
+        return false;
+    }
+
+    romHash = getU32(header + 8) | (static_cast<uint64_t>(getU32(header + 12)) << 32);
+    uint32_t count = getU32(header + 16);
+
+    // the count comes from the file, don't allocate for frames that aren't there
+    std::streampos dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff available = file.tellg() - dataStart;
+    file.seekg(dataStart);
+    if (static_cast<uint64_t>(count) * MOVIE_FRAME_SIZE > static_cast<uint64_t>(available)) {
+        std::cerr << "Movie is truncated: " << path << std::endl;
+        return false;
+    }
+
+    frames.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t bytes[MOVIE_FRAME_SIZE];
+        file.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+        frames[i] = { bytes[0], { bytes[1], bytes[2] } };
+    }
+    if (!file.good()) {
+        std::cerr << "Movie is truncated: " << path << std::endl;
+        frames.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Movie::save(const char* path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not write movie: " << path << std::endl;
+        return false;
+    }
+
+    uint8_t header[MOVIE_HEADER_SIZE];
+    std::memcpy(header, MOVIE_MAGIC, sizeof(MOVIE_MAGIC));
+    putU32(header + 4, VERSION);
+    putU32(header + 8, romHash & 0xFFFFFFFF);
+    putU32(header + 12, romHash >> 32);
+    putU32(header + 16, static_cast<uint32_t>(frames.size()));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    for (const MovieFrame& frame : frames) {
+        char bytes[MOVIE_FRAME_SIZE] = {
+            static_cast<char>(frame.commands),
+            static_cast<char>(frame.joypad[0]),
+            static_cast<char>(frame.joypad[1])
+        };
+        file.write(bytes, sizeof(bytes));
+    }
+    return file.good();
+}
+
+// FM2 gamepad fields list the buttons as RLDUTSBA, any character but '.' or ' ' is pressed
+static bool parseFm2Gamepad(const std::string& field, uint8_t& buttons) {
+    static const uint8_t order[8] = {
+        JOYPAD_RIGHT, JOYPAD_LEFT, JOYPAD_DOWN, JOYPAD_UP, JOYPAD_START, JOYPAD_SELECT, JOYPAD_B, JOYPAD_A
+    };
+    buttons = 0;
+    if (field.empty()) {
+        return true;
+    }
+    if (field.size() != 8) {
+        return false;
+    }
+    for (int i = 0; i < 8; i++) {
+        if (field[i] != '.' && field[i] != ' ') {
+            buttons |= order[i];
+        }
+    }
+    return true;
+}
+
+bool Movie::loadFm2(const char* path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open movie: " << path << std::endl;
+        return false;
+    }
+
+    romHash = 0;
+    frames.clear();
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        if (line[0] != '|') {
+            std::string key = line.substr(0, line.find(' '));
+            std::string value = key.size() < line.size() ? line.substr(key.size() + 1) : "";
+            if ((key == "binary" && value != "0") || (key == "fourscore" && value != "0")) {
+                std::cerr << "FM2 " << key << " movies are not supported" << std::endl;
+                return false;
+            }
+            if ((key == "port0" || key == "port1") && value != "0" && value != "1") {
+                std::cerr << "FM2 " << key << " has a device other than a gamepad" << std::endl;
+                return false;
+            }
+            if (key == "savestate" && !value.empty()) {
+                std::cerr << "FM2 movies that start from a savestate are not supported" << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        // |commands|port0|port1|port2|
+        std::string fields[4];
+        size_t start = 1;
+        for (int i = 0; i < 4 && start <= line.size(); i++) {
+            size_t end = line.find('|', start);
+            if (end == std::string::npos) {
+                end = line.size();
+            }
+            fields[i] = line.substr(start, end - start);
+            start = end + 1;
+        }
+
+        MovieFrame frame = {};
+        int commands = std::atoi(fields[0].c_str());
+        frame.commands |= (commands & 0x01) ? MOVIE_RESET : 0;
+        frame.commands |= (commands & 0x02) ? MOVIE_POWER : 0;
+        if (!parseFm2Gamepad(fields[1], frame.joypad[0]) || !parseFm2Gamepad(fields[2], frame.joypad[1])) {
+            std::cerr << "Bad FM2 input on line " << lineNumber << std::endl;
+            frames.clear();
+            return false;
+        }
+        frames.push_back(frame);
+    }
+
+    return true;
+}
+
+uint64_t Movie::hashRom(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    char buffer[4096];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        hash = hashBytes(hash, reinterpret_cast<const uint8_t*>(buffer), file.gcount());
+    }
+    return hash;
+}
+
+uint64_t Movie::hashBytes(uint64_t hash, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void Movie::record(const System* system, uint8_t commands) {
+    frames.push_back({ commands, { system->joypad->getState(), system->joypad2->getState() } });
+}
+
+bool Movie::apply(System* system, size_t frame) const {
+    if (frame >= frames.size()) {
+        return false;
+    }
+
+    const MovieFrame& input = frames[frame];
+    if (input.commands & MOVIE_POWER) {
+        system->power();
+    }
+    if (input.commands & MOVIE_RESET) {
+        system->reset();
+    }
+    system->joypad->setState(input.joypad[0]);
+    system->joypad2->setState(input.joypad[1]);
+    return true;
+}
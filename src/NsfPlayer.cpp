@@ -0,0 +1,177 @@
+#include <NsfPlayer.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+using namespace Nsf;
+
+static uint16_t readWord(const uint8_t* bytes) {
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static std::string readString(const char* text, size_t size) {
+    return std::string(text, strnlen(text, size));
+}
+
+NsfPlayer::NsfPlayer(std::string path) {
+    system = new System();
+    system->cpu->logging = false;
+    loaded = false;
+    routineRunning = false;
+    skippedPlays = 0;
+    frameStart = 0;
+    songCount = 0;
+    startingSong = 1;
+    loadAddress = 0;
+    initAddress = 0;
+    playAddress = 0;
+    cyclesPerPlay = APU::CPU_CLOCK / 60;
+
+    std::ifstream file;
+    file.open(path, std::ios::binary | std::ios::in);
+
+    nsf_header header;
+    static_assert(sizeof(nsf_header) == 0x80, "NSF header must be 128 bytes");
+    if (!file.read((char*)&header, sizeof(nsf_header)) || std::memcmp(header.magic, "NESM\x1A", 5) != 0) {
+        std::cerr << "Not an NSF file: " << path << std::endl;
+        return;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        if (header.bankswitch[i] != 0) {
+            std::cerr << "Bankswitched NSF files are not supported" << std::endl;
+            return;
+        }
+    }
+    if (header.extra_sound_chips != 0) {
+        std::cerr << "NSF expansion audio is not supported, playing the 2A03 part only" << std::endl;
+    }
+
+    loadAddress = readWord(header.load_addr);
+    initAddress = readWord(header.init_addr);
+    playAddress = readWord(header.play_addr);
+    if (loadAddress < 0x8000) {
+        std::cerr << "Unsupported NSF load address: " << std::hex << loadAddress << std::endl;
+        return;
+    }
+
+    songCount = header.total_songs;
+    startingSong = header.starting_song == 0 ? 1 : header.starting_song;
+    title = readString(header.name, sizeof(header.name));
+    artist = readString(header.artist, sizeof(header.artist));
+    copyright = readString(header.copyright, sizeof(header.copyright));
+
+    uint16_t speed = readWord(header.ntsc_speed);
+    if (speed != 0) {
+        cyclesPerPlay = static_cast<uint64_t>(speed) * APU::CPU_CLOCK / 1000000;
+    }
+
+    std::vector<uint8_t> data(0x10000 - loadAddress);
+    file.read((char*)data.data(), data.size());
+    system->bus->writeBytes(loadAddress, data.data(), file.gcount());
+
+    loaded = true;
+    selectSong(startingSong);
+}
+
+NsfPlayer::~NsfPlayer() {
+    delete system;
+}
+
+bool NsfPlayer::isLoaded() const {
+    return loaded;
+}
+
+void NsfPlayer::selectSong(uint8_t song) {
+    Bus* bus = system->bus;
+    for (uint16_t address = 0x0000; address < 0x0800; address++) {
+        bus->write(address, 0);
+    }
+    for (uint16_t address = 0x6000; address < 0x8000; address++) {
+        bus->write(address, 0);
+    }
+    for (uint16_t address = 0x4000; address <= 0x4013; address++) {
+        bus->write(address, 0);
+    }
+    bus->write(0x4015, 0x0F);
+    bus->write(0x4017, 0x40);
+
+    CPU* cpu = system->cpu;
+    cpu->accumulator = song - 1;
+    cpu->xIndex = 0; // NTSC
+    cpu->yIndex = 0;
+    cpu->stackPointer = 0xFD;
+
+    // INIT may unpack data or build tables, give it a second before giving up
+    if (!callRoutine(initAddress, APU::CPU_CLOCK)) {
+        std::cerr << "NSF INIT routine did not return" << std::endl;
+    }
+    system->apu->endFrame();
+    system->apu->clearSamples();
+    frameStart = system->masterCycles;
+    skippedPlays = 0;
+}
+
+FrameView NsfPlayer::playFrame() {
+    system->apu->clearSamples();
+
+    // like a hardware player, a routine that overran keeps going instead of PLAY being called on
+    // top of it, which would leave its return address on the stack and re-enter PLAY halfway.
+    // the frame still ends on time, so a slow routine costs PLAY calls and not the tempo
+    uint64_t frameEnd = frameStart + cyclesPerPlay;
+    uint64_t budget = frameEnd > system->masterCycles ? frameEnd - system->masterCycles : 0;
+    if (routineRunning) {
+        skippedPlays++;
+        runCpu(budget);
+        routineRunning = system->cpu->programCounter != RETURN_ADDRESS;
+    } else {
+        callRoutine(playAddress, budget);
+    }
+
+    // the last instruction can run a few cycles past frameEnd, the next frame starts short
+    if (system->masterCycles < frameEnd) {
+        system->apu->tick(frameEnd - system->masterCycles);
+        system->masterCycles = frameEnd;
+    }
+    frameStart = frameEnd;
+    system->apu->endFrame();
+    system->frameCount++;
+
+    return FrameView {
+        nullptr,
+        system->apu->getSamples(),
+        system->apu->getSampleCount(),
+        system->frameCount
+    };
+}
+
+bool NsfPlayer::callRoutine(uint16_t address, uint64_t maxCycles) {
+    CPU* cpu = system->cpu;
+    cpu->pushWord(RETURN_ADDRESS - 1);
+    cpu->programCounter = address;
+    runCpu(maxCycles);
+    routineRunning = cpu->programCounter != RETURN_ADDRESS;
+    return !routineRunning;
+}
+
+// like System::stepInstruction but without clocking the PPU
+uint64_t NsfPlayer::runCpu(uint64_t maxCycles) {
+    CPU* cpu = system->cpu;
+    uint64_t total = 0;
+    while (cpu->programCounter != RETURN_ADDRESS && total < maxCycles && !system->stop) {
+        size_t cyclesBefore = cpu->getCycles();
+        cpu->execOnce();
+        system->instructionCount++;
+        while (cpu->getCycles() != cyclesBefore) {
+            size_t elapsed = cpu->getCycles() - cyclesBefore;
+            cyclesBefore = cpu->getCycles();
+            system->apu->tick(elapsed);
+            system->masterCycles += elapsed;
+            total += elapsed;
+            cpu->stall(system->bus->takeStallCycles());
+        }
+    }
+    return total;
+}
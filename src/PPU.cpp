@@ -1,11 +1,15 @@
 #include <PPU.hpp>
+#include <SaveState.hpp>
+#include <Trace.hpp>
 
 #include <iostream>
+#include <cstring>
 
 PPU::PPU() {
     vram = new uint8_t[0x4000];
     oam = new uint8_t[0x100];
     palette = new uint8_t[0x20];
+    frameBuffer = new uint8_t[SCREEN_WIDTH * SCREEN_HEIGHT];
     chrRom = std::vector<uint8_t>(0x2000);
     oamAddr = 0;
     mirroring = Mirroring::HORIZONTAL;
@@ -30,6 +34,11 @@ PPU::PPU() {
         palette[i] = 0;
     }
 
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        frameBuffer[i] = 0;
+    }
+
+    renderFrames = true;
     nmiInterrupt = false;
     cycles = 0;
     scanline = 0;
@@ -39,6 +48,7 @@ PPU::~PPU() {
     delete[] vram;
     delete[] oam;
     delete[] palette;
+    delete[] frameBuffer;
     delete controlRegister;
     delete maskRegister;
     delete statusRegister;
@@ -46,9 +56,26 @@ PPU::~PPU() {
     delete addrRegister;
 }
 
+void PPU::reset() {
+    std::memset(vram, 0, 0x4000);
+    std::memset(oam, 0, 0x100);
+    std::memset(palette, 0, 0x20);
+    *controlRegister = ControlRegister();
+    *maskRegister = MaskRegister();
+    *statusRegister = StatusRegister();
+    *scrollRegister = ScrollRegister();
+    *addrRegister = AddrRegister();
+    oamAddr = 0;
+    dataBuffer = 0;
+    nmiInterrupt = false;
+    cycles = 0;
+    scanline = 0;
+}
+
 void PPU::setChrRom(uint8_t* chrRom, size_t size) {
+    // carts with CHR RAM report a size of 0, keep the full 8k pattern space addressable
     if (this->chrRom.size() != size) {
-        this->chrRom.resize(size);
+        this->chrRom.resize(size < 0x2000 ? 0x2000 : size);
     }
     
     for (size_t i = 0; i < size; i++) {
@@ -84,6 +111,15 @@ uint16_t PPU::mirrorVramAddress(uint16_t address) {
     return mirroredVram;
 }
 
+// $3F20-$3FFF repeat the 32 palette bytes, and $3F10/$3F14/$3F18/$3F1C are the background entries
+uint8_t PPU::mirrorPaletteAddress(uint16_t address) {
+    uint8_t index = address & 0x1F;
+    if ((index & 0x13) == 0x10) {
+        index &= 0x0F;
+    }
+    return index;
+}
+
 void PPU::incrementVramAddress() {
     this->addrRegister->increment(this->controlRegister->vram_addr_increment());
 }
@@ -125,11 +161,8 @@ void PPU::writeToDataRegister(uint8_t data) {
         this->vram[this->mirrorVramAddress(address)] = data;
     } else if (address < 0x3F00) {
         std::cerr << "This address should not be written to" << std::endl;
-    } else if (address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C) {
-        uint16_t mirroredAddress = address - 0x10;
-        this->palette[mirroredAddress - 0x3F00] = data;
     } else if (address >= 0x3F00 && address < 0x4000) {
-        this->palette[address - 0x3F00] = data;
+        this->palette[this->mirrorPaletteAddress(address)] = data;
     } else {
         std::cerr << "Invalid PPU write address: " << std::hex << address << std::endl;
     }
@@ -170,11 +203,8 @@ uint8_t PPU::readFromDataRegister() {
     } else if (address < 0x3F00) {
         std::cerr << "This address should not be read from" << std::endl;
         return 0;
-    } else if (address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C) {
-        uint16_t mirroredAddress = address - 0x10;
-        return this->palette[mirroredAddress - 0x3F00];
     } else if (address >= 0x3F00 && address < 0x4000) {
-        return this->palette[address - 0x3F00];
+        return this->palette[this->mirrorPaletteAddress(address)];
     } else {
         std::cerr << "Invalid PPU read address: " << std::hex << address << std::endl;
         return 0;
@@ -182,13 +212,18 @@ uint8_t PPU::readFromDataRegister() {
 }
 
 
-bool PPU::tick(uint8_t cycles) {
+bool PPU::tick(uint16_t cycles) {
+    bool frameDone = false;
     this->cycles += cycles;
-    if (this->cycles >= 341) {
+    // DMA stalls can cover several scanlines in one call
+    while (this->cycles >= 341) {
         this->cycles -= 341;
         this->scanline++;
 
         if (this->scanline == 241) {
+            if (this->renderFrames) {
+                renderFrame();
+            }
             this->statusRegister->set_vblank_status(true);
             this->statusRegister->set_sprite_zero_hit(false);
             if (this->controlRegister->generate_vblank_nmi()) {
@@ -203,11 +238,11 @@ bool PPU::tick(uint8_t cycles) {
             this->statusRegister->set_sprite_zero_hit(false);
             this->statusRegister->reset_vblank_status();
             
-            return true;
+            frameDone = true;
         }
     }
 
-    return false;
+    return frameDone;
 }
 
 bool PPU::pollNmiInterrupt() {
@@ -217,3 +252,107 @@ bool PPU::pollNmiInterrupt() {
     }
     return false;
 }
+
+void PPU::renderFrame() {
+    TRACE_SCOPE("ppu render");
+    renderBackground();
+    renderSprites();
+}
+
+void PPU::renderBackground() {
+    uint16_t bank = this->controlRegister->bknd_pattern_addr();
+
+    for (int i = 0; i < 0x03C0; i++) {
+        int tileX = i % 32;
+        int tileY = i / 32;
+        uint16_t tileStart = bank + this->vram[i] * 16;
+
+        uint8_t attributeByte = this->vram[0x3C0 + tileY / 4 * 8 + tileX / 4];
+        uint8_t shift = ((tileX % 4) / 2 + (tileY % 4) / 2 * 2) * 2;
+        uint8_t paletteStart = ((attributeByte >> shift) & 0b11) * 4;
+
+        for (int y = 0; y < 8; y++) {
+            uint8_t upper = this->chrRom[tileStart + y];
+            uint8_t lower = this->chrRom[tileStart + y + 8];
+            uint8_t* row = &this->frameBuffer[(tileY * 8 + y) * SCREEN_WIDTH + tileX * 8];
+
+            for (int x = 7; x >= 0; x--) {
+                int value = (1 & lower) << 1 | (1 & upper);
+                upper >>= 1;
+                lower >>= 1;
+
+                uint8_t color = value == 0 ? this->palette[0] : this->palette[paletteStart + value];
+                row[x] = color & 0x3F;
+            }
+        }
+    }
+}
+
+void PPU::renderSprites() {
+    uint16_t bank = this->controlRegister->sprt_pattern_addr();
+
+    for (int i = 63; i >= 0; i--) {
+        int spriteIdx = i * 4;
+        int tileY = this->oam[spriteIdx];
+        uint16_t tileStart = bank + this->oam[spriteIdx + 1] * 16;
+        uint8_t attributes = this->oam[spriteIdx + 2];
+        int tileX = this->oam[spriteIdx + 3];
+
+        bool flipVertical = attributes & 0x80;
+        bool flipHorizontal = attributes & 0x40;
+        uint8_t paletteStart = 0x11 + (attributes & 0x3) * 4;
+
+        for (int y = 0; y < 8; y++) {
+            uint8_t upper = this->chrRom[tileStart + y];
+            uint8_t lower = this->chrRom[tileStart + y + 8];
+            int py = tileY + (flipVertical ? 7 - y : y);
+
+            for (int x = 7; x >= 0; x--) {
+                int value = (1 & lower) << 1 | (1 & upper);
+                upper >>= 1;
+                lower >>= 1;
+
+                int px = tileX + (flipHorizontal ? 7 - x : x);
+                if (value == 0 || px >= SCREEN_WIDTH || py >= SCREEN_HEIGHT) {
+                    continue;
+                }
+
+                this->frameBuffer[py * SCREEN_WIDTH + px] = this->palette[paletteStart + value - 1] & 0x3F;
+            }
+        }
+    }
+}
+
+void PPU::saveState(StateWriter& state) const {
+    state.writeBytes(vram, NAMETABLE_SIZE);
+    state.writeBytes(oam, 0x100);
+    state.writeBytes(palette, 0x20);
+    state.write(oamAddr);
+    state.write(mirroring);
+    state.write(nmiInterrupt);
+    state.write(dataBuffer);
+    state.write(cycles);
+    state.write(scanline);
+    controlRegister->saveState(state);
+    maskRegister->saveState(state);
+    statusRegister->saveState(state);
+    scrollRegister->saveState(state);
+    addrRegister->saveState(state);
+}
+
+void PPU::loadState(StateReader& state) {
+    state.readBytes(vram, NAMETABLE_SIZE);
+    state.readBytes(oam, 0x100);
+    state.readBytes(palette, 0x20);
+    state.read(oamAddr);
+    state.read(mirroring);
+    state.read(nmiInterrupt);
+    state.read(dataBuffer);
+    state.read(cycles);
+    state.read(scanline);
+    controlRegister->loadState(state);
+    maskRegister->loadState(state);
+    statusRegister->loadState(state);
+    scrollRegister->loadState(state);
+    addrRegister->loadState(state);
+}
@@ -0,0 +1,110 @@
+#include <Profiler.hpp>
+#include <Symbols.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+Profiler::Profiler(Symbols* symbols) {
+    this->symbols = symbols;
+    nodes.push_back({ 0, CallKind::ROOT, 0, 0, 0 });
+    frameNumber = 0;
+    resetStack();
+}
+
+Profiler::~Profiler() {
+}
+
+void Profiler::resetStack() {
+    stack[0] = { 0, 0xFF };
+    depth = 1;
+}
+
+void Profiler::call(uint16_t address, uint8_t stackPointer, CallKind kind) {
+    if (depth == MAX_DEPTH) {
+        // runaway recursion, or a stack the shadow lost track of. keep charging the top
+        return;
+    }
+
+    uint32_t parent = stack[depth - 1].node;
+    uint64_t key = (static_cast<uint64_t>(parent) << 24) | (static_cast<uint64_t>(kind) << 16) | address;
+    auto child = children.find(key);
+    uint32_t node;
+    if (child != children.end()) {
+        node = child->second;
+    } else {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({ address, kind, parent, 0, 0 });
+        children.emplace(key, node);
+    }
+
+    stack[depth++] = { node, stackPointer };
+}
+
+void Profiler::ret(uint8_t stackPointer) {
+    // the stack grows down, anything entered at or below where S is now has returned
+    while (depth > 1 && stack[depth - 1].stackPointer <= stackPointer) {
+        depth--;
+    }
+}
+
+void Profiler::endFrame() {
+    for (uint32_t node : touched) {
+        frames.push_back({ frameNumber, node, nodes[node].frameCycles });
+        nodes[node].frameCycles = 0;
+    }
+    touched.clear();
+    frameNumber++;
+}
+
+uint64_t Profiler::getTotalCycles() const {
+    uint64_t total = 0;
+    for (const Node& node : nodes) {
+        total += node.cycles;
+    }
+    return total;
+}
+
+std::string Profiler::pathOf(uint32_t index) const {
+    const Node& node = nodes[index];
+    if (node.kind == CallKind::ROOT) {
+        return "reset";
+    }
+
+    static const char* const prefixes[] = { "", "", "nmi:", "irq:", "brk:" };
+    std::string name = prefixes[static_cast<int>(node.kind)];
+    if (symbols != nullptr) {
+        name += symbols->format(node.address, 4);
+    } else {
+        char address[8];
+        std::snprintf(address, sizeof(address), "$%04X", node.address);
+        name += address;
+    }
+    return pathOf(node.parent) + ";" + name;
+}
+
+bool Profiler::writeCollapsed(const char* path, bool perFrame) const {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not write profile: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> paths(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        paths[i] = pathOf(static_cast<uint32_t>(i));
+    }
+
+    if (perFrame) {
+        for (const FrameSample& sample : frames) {
+            file << "frame " << sample.frame << ";" << paths[sample.node] << " " << sample.cycles << "\n";
+        }
+    } else {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i].cycles > 0) {
+                file << paths[i] << " " << nodes[i].cycles << "\n";
+            }
+        }
+    }
+    return file.good();
+}
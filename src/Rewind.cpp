@@ -0,0 +1,217 @@
+#include <Rewind.hpp>
+
+#include <iostream>
+#include <cstring>
+
+// a delta of an idle frame compresses to a few dozen bytes, so bound the entry table by
+// what a busy game stores per frame instead
+#define ARENA_BYTES_PER_ENTRY 256
+
+RewindBuffer::RewindBuffer(size_t capacityBytes, size_t keyframeInterval) {
+    this->keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+    capacity = capacityBytes;
+    arena = new uint8_t[capacity];
+    maxEntries = capacity / ARENA_BYTES_PER_ENTRY + 1;
+    entries = new Entry[maxEntries];
+    clear();
+}
+
+RewindBuffer::~RewindBuffer() {
+    delete[] arena;
+    delete[] entries;
+}
+
+bool RewindBuffer::stepBack(System* system, Movie* record, const Movie* playback, size_t& frame) {
+    if (!pop(system)) {
+        return false;
+    }
+    if (frame > 0) {
+        frame--;
+    }
+    if (record != nullptr && !record->frames.empty()) {
+        record->frames.pop_back();
+    }
+    if (!pop(system)) {
+        return false;
+    }
+
+    // the snapshot goes straight back in, it's still the start of the frame about to run.
+    // without a movie the restored joypads already hold what that frame saw
+    push(system);
+    const Movie* input = record != nullptr ? record : playback;
+    if (input != nullptr && frame > 0) {
+        input->apply(system, frame - 1);
+    }
+    return true;
+}
+
+void RewindBuffer::clear() {
+    writePosition = 0;
+    oldest = 0;
+    count = 0;
+    nextId = 0;
+    keyframeSize = 0;
+    keyframeId = UINT64_MAX;
+}
+
+size_t RewindBuffer::getEntryCount() const {
+    return count;
+}
+
+size_t RewindBuffer::getBytesUsed() const {
+    if (count == 0) {
+        return 0;
+    }
+    size_t start = entries[oldest].offset;
+    return writePosition > start ? writePosition - start : capacity - start + writePosition;
+}
+
+// index 0 is the oldest entry
+RewindBuffer::Entry& RewindBuffer::entryAt(size_t index) {
+    return entries[(oldest + index) % maxEntries];
+}
+
+// the keyframe a delta was taken against is always the closest one before it
+size_t RewindBuffer::findKeyframe(size_t index) {
+    while (!entryAt(index).keyframe) {
+        index--;
+    }
+    return index;
+}
+
+bool RewindBuffer::decodeKeyframe(size_t index) {
+    Entry& entry = entryAt(index);
+    if (keyframeId == entry.id) {
+        return true;
+    }
+    keyframeSize = lz::decompress(arena + entry.offset, entry.size, keyframe, sizeof(keyframe));
+    keyframeId = keyframeSize > 0 ? entry.id : UINT64_MAX;
+    return keyframeSize > 0;
+}
+
+void RewindBuffer::evictOldest() {
+    oldest = (oldest + 1) % maxEntries;
+    count--;
+    // deltas are useless without their keyframe
+    while (count > 0 && !entries[oldest].keyframe) {
+        oldest = (oldest + 1) % maxEntries;
+        count--;
+    }
+}
+
+// live data runs from the oldest entry up to writePosition, possibly wrapping once
+uint8_t* RewindBuffer::allocate(size_t size) {
+    if (size > capacity) {
+        return nullptr;
+    }
+    if (count == maxEntries) {
+        evictOldest();
+    }
+
+    while (count > 0) {
+        size_t start = entries[oldest].offset;
+        if (start < writePosition) {
+            // free space is the tail of the arena and the gap before the oldest entry
+            if (writePosition + size <= capacity) {
+                break;
+            }
+            writePosition = 0;
+        } else if (writePosition + size <= start) {
+            break;
+        } else {
+            evictOldest();
+        }
+    }
+
+    if (count == 0 && writePosition + size > capacity) {
+        writePosition = 0;
+    }
+
+    uint8_t* block = arena + writePosition;
+    writePosition += size;
+    return block;
+}
+
+void RewindBuffer::push(const System* system) {
+    size_t size = system->saveState(state, sizeof(state));
+    if (size == 0) {
+        return;
+    }
+
+    // a delta needs the newest keyframe decoded and not too far back
+    bool asKeyframe = true;
+    if (count > 0) {
+        size_t key = findKeyframe(count - 1);
+        asKeyframe = count - key >= keyframeInterval || !decodeKeyframe(key) || keyframeSize != size;
+    }
+
+    if (!asKeyframe) {
+        for (size_t i = 0; i < size; i++) {
+            state[i] ^= keyframe[i];
+        }
+    }
+
+    size_t compressedSize = lz::compress(state, size, compressed, sizeof(compressed));
+    uint8_t* block = compressedSize > 0 ? allocate(compressedSize) : nullptr;
+
+    if (block != nullptr && !asKeyframe && count == 0) {
+        // making room dropped the keyframe this delta was taken against, store it whole instead
+        for (size_t i = 0; i < size; i++) {
+            state[i] ^= keyframe[i];
+        }
+        asKeyframe = true;
+        writePosition = 0;
+        compressedSize = lz::compress(state, size, compressed, sizeof(compressed));
+        block = compressedSize > 0 ? allocate(compressedSize) : nullptr;
+    }
+
+    if (block == nullptr) {
+        std::cerr << "Rewind buffer is too small for a savestate" << std::endl;
+        return;
+    }
+    std::memcpy(block, compressed, compressedSize);
+
+    Entry& entry = entries[(oldest + count) % maxEntries];
+    entry.id = nextId++;
+    entry.offset = static_cast<uint32_t>(block - arena);
+    entry.size = static_cast<uint32_t>(compressedSize);
+    entry.keyframe = asKeyframe;
+    count++;
+
+    // the raw keyframe is still in state, keep it as the delta reference
+    if (asKeyframe) {
+        std::memcpy(keyframe, state, size);
+        keyframeSize = size;
+        keyframeId = entry.id;
+    }
+}
+
+bool RewindBuffer::pop(System* system) {
+    if (count == 0) {
+        return false;
+    }
+
+    size_t index = count - 1;
+    Entry entry = entryAt(index);
+    bool restored;
+    if (entry.keyframe) {
+        restored = decodeKeyframe(index) && system->loadState(keyframe, keyframeSize);
+    } else {
+        size_t size = 0;
+        if (decodeKeyframe(findKeyframe(index))) {
+            size = lz::decompress(arena + entry.offset, entry.size, state, sizeof(state));
+        }
+        for (size_t i = 0; i < size && i < keyframeSize; i++) {
+            state[i] ^= keyframe[i];
+        }
+        restored = size > 0 && system->loadState(state, size);
+    }
+
+    // the newest entry always ends at writePosition, so its space is free again
+    count--;
+    writePosition = entry.offset;
+    if (keyframeId == entry.id) {
+        keyframeId = UINT64_MAX;
+    }
+    return restored;
+}
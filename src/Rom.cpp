@@ -3,6 +3,10 @@
 #include <fstream>
 #include <iostream>
 
+#define TRAINER_SIZE 512
+#define PRG_BANK_SIZE 0x4000
+#define CHR_BANK_SIZE 0x2000
+
 using namespace Rom;
 
 void Rom::loadRom(const char* path, Bus* memory, PPU* ppu) {
@@ -11,20 +15,14 @@ void Rom::loadRom(const char* path, Bus* memory, PPU* ppu) {
 
     nes_header header;
     file.read((char*)&header, sizeof(nes_header));
-    if (header.flag6 & 0x04) {
-        file.seekg(512, std::ios::cur);
-    }
+    file.seekg(getPrgOffset(header));
 
     bool verticalMirroring = header.flag6 & 0x01;
 
-    if (header.flag7 == 0x44) {
-        header.flag7 = 0;
-    }
-
-    int mapper = ((header.flag6 & 0xf0) >> 4) + ((header.flag7 & 0xf0));
+    int mapper = getMapper(header);
 
-    int prgSize = header.prg_size * 0x4000;
-    int chrSize = header.chr_size * 0x2000;
+    int prgSize = header.prg_size * PRG_BANK_SIZE;
+    int chrSize = header.chr_size * CHR_BANK_SIZE;
 
     uint8_t* prg_rom = new uint8_t[prgSize];
     uint8_t* chr_rom = new uint8_t[chrSize];
@@ -39,6 +37,35 @@ void Rom::loadRom(const char* path, Bus* memory, PPU* ppu) {
             memory->writeBytes(0xC000, prg_rom, prgSize);
         }
     } else {
-        std::cout << "Unsupported mapper: " << mapper << std::endl;
+        std::cerr << "Unsupported mapper: " << mapper << std::endl;
     }
-}
\ No newline at end of file
+
+    delete[] prg_rom;
+    delete[] chr_rom;
+}
+
+int Rom::getMapper(const nes_header& header) {
+    // old dumping tools left "DiskDude!" where byte 7 is now, which reads as 0x44
+    uint8_t flag7 = header.flag7 == 0x44 ? 0 : header.flag7;
+    return ((header.flag6 & 0xf0) >> 4) + (flag7 & 0xf0);
+}
+
+size_t Rom::getPrgOffset(const nes_header& header) {
+    return sizeof(nes_header) + (header.flag6 & 0x04 ? TRAINER_SIZE : 0);
+}
+
+bool Rom::hasFullImage(const char* path, const nes_header& header) {
+    std::ifstream file(path, std::ios::binary | std::ios::in | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    // a CHR RAM board has chr_size 0 and nothing after its PRG ROM
+    size_t expected = getPrgOffset(header) + header.prg_size * PRG_BANK_SIZE + header.chr_size * CHR_BANK_SIZE;
+    return static_cast<size_t>(file.tellg()) >= expected;
+}
+
+bool Rom::readHeader(const char* path, nes_header& header) {
+    std::ifstream file(path, std::ios::binary | std::ios::in);
+    file.read((char*)&header, sizeof(nes_header));
+    return file.good() && header.magic[0] == 0x4E && header.magic[1] == 0x45 && header.magic[2] == 0x53 && header.magic[3] == 0x1A;
+}
@@ -0,0 +1,85 @@
+#include <Stats.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+static const char* const REGION_NAMES[static_cast<int>(BusRegion::COUNT)] = {
+    "ram", "ppu", "apu", "unmapped", "prg_ram", "prg_rom"
+};
+
+Stats::Stats() {
+    clear();
+}
+
+void Stats::clear() {
+    std::memset(opcodes, 0, sizeof(opcodes));
+    std::memset(busReads, 0, sizeof(busReads));
+    std::memset(busWrites, 0, sizeof(busWrites));
+    std::memset(ppuRegisterWrites, 0, sizeof(ppuRegisterWrites));
+    nmis = 0;
+    irqs = 0;
+    oamDmas = 0;
+    dmcDmas = 0;
+    framesRendered = 0;
+}
+
+BusRegion Stats::regionOf(uint16_t address) {
+    if (address < 0x2000) {
+        return BusRegion::RAM;
+    } else if (address < 0x4000) {
+        return BusRegion::PPU;
+    } else if (address < 0x4020) {
+        return BusRegion::APU;
+    } else if (address < 0x6000) {
+        return BusRegion::UNMAPPED;
+    } else if (address < 0x8000) {
+        return BusRegion::PRG_RAM;
+    }
+    return BusRegion::PRG_ROM;
+}
+
+void Stats::dump(std::ostream& out) const {
+    if (!ENABLED) {
+        out << "stats: not counted, build with make STATS=1" << std::endl;
+        return;
+    }
+
+    out << "stats: " << framesRendered << " frames rendered, " << nmis << " NMIs, " << irqs << " IRQs, "
+        << oamDmas << " OAM DMAs, " << dmcDmas << " DMC DMAs" << std::endl;
+
+    out << "bus reads:";
+    for (int i = 0; i < static_cast<int>(BusRegion::COUNT); i++) {
+        out << " " << REGION_NAMES[i] << " " << busReads[i];
+    }
+    out << std::endl << "bus writes:";
+    for (int i = 0; i < static_cast<int>(BusRegion::COUNT); i++) {
+        out << " " << REGION_NAMES[i] << " " << busWrites[i];
+    }
+    out << std::endl << "ppu register writes:";
+    for (int i = 0; i < 8; i++) {
+        out << " $200" << i << " " << ppuRegisterWrites[i];
+    }
+    out << std::endl;
+
+    uint64_t instructions = 0;
+    std::vector<int> executed;
+    for (int i = 0; i < 256; i++) {
+        instructions += opcodes[i];
+        if (opcodes[i] > 0) {
+            executed.push_back(i);
+        }
+    }
+    std::stable_sort(executed.begin(), executed.end(), [this](int a, int b) {
+        return opcodes[a] > opcodes[b];
+    });
+
+    out << "opcodes: " << instructions << " instructions, " << executed.size() << " distinct" << std::endl;
+    for (int opcode : executed) {
+        out << "  $" << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << opcode
+            << std::dec << std::nouppercase << std::setfill(' ') << " " << opcodes[opcode]
+            << " (" << std::fixed << std::setprecision(2) << 100.0 * opcodes[opcode] / instructions << "%)"
+            << std::defaultfloat << std::endl;
+    }
+}
@@ -0,0 +1,255 @@
+#include <Symbols.hpp>
+#include <Stats.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+// iNES header in front of PRG in the .nes ld65 writes, and the size of a PRG bank
+#define INES_HEADER_SIZE 16
+#define PRG_BANK_SIZE 0x4000
+
+Symbols::Symbols() {
+}
+
+Symbols::~Symbols() {
+}
+
+bool Symbols::add(const char* path) {
+    if (!std::ifstream(path).good()) {
+        std::cerr << "Could not open symbols: " << path << std::endl;
+        return false;
+    }
+    pending.push_back(path);
+    return true;
+}
+
+size_t Symbols::size() {
+    load();
+    return symbols.size();
+}
+
+void Symbols::load() {
+    if (pending.empty()) {
+        return;
+    }
+
+    for (const std::string& path : pending) {
+        std::ifstream file(path);
+        std::string first;
+        std::getline(file, first);
+        file.seekg(0);
+
+        // ld65 starts every debug file with its version line
+        bool loaded = first.compare(0, 8, "version\t") == 0 ? loadDbg(file) : loadLabels(file);
+        if (!loaded) {
+            std::cerr << "No symbols in " << path << std::endl;
+        }
+    }
+    pending.clear();
+
+    std::stable_sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.start < b.start;
+    });
+
+    maxEnd.resize(symbols.size());
+    uint32_t end = 0;
+    for (size_t i = 0; i < symbols.size(); i++) {
+        end = std::max(end, symbols[i].end);
+        maxEnd[i] = end;
+    }
+}
+
+// every line is a record type, a tab and comma separated key=value pairs, with strings quoted
+static std::unordered_map<std::string, std::string> parseDbgFields(const std::string& fields) {
+    std::unordered_map<std::string, std::string> values;
+    size_t i = 0;
+    while (i < fields.size()) {
+        size_t equals = fields.find('=', i);
+        if (equals == std::string::npos) {
+            break;
+        }
+        std::string key = fields.substr(i, equals - i);
+        size_t end;
+        if (equals + 1 < fields.size() && fields[equals + 1] == '"') {
+            end = fields.find('"', equals + 2);
+            if (end == std::string::npos) {
+                break;
+            }
+            values[key] = fields.substr(equals + 2, end - equals - 2);
+            end++;
+        } else {
+            end = fields.find(',', equals);
+            if (end == std::string::npos) {
+                end = fields.size();
+            }
+            values[key] = fields.substr(equals + 1, end - equals - 1);
+        }
+        i = end + 1;
+    }
+    return values;
+}
+
+static unsigned long parseNumber(const std::string& text) {
+    return std::strtoul(text.c_str(), nullptr, 0);
+}
+
+bool Symbols::loadDbg(std::istream& file) {
+    struct Segment {
+        unsigned long start;
+        // where the segment sits in the output file, -1 for RAM
+        long offset;
+    };
+    std::unordered_map<std::string, Segment> segments;
+
+    struct Label {
+        unsigned long value;
+        unsigned long size;
+        std::string segment;
+        std::string name;
+    };
+    std::vector<Label> labels;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+        std::string type = line.substr(0, tab);
+        if (type != "seg" && type != "sym") {
+            continue;
+        }
+
+        std::unordered_map<std::string, std::string> fields = parseDbgFields(line.substr(tab + 1));
+        if (type == "seg") {
+            Segment segment;
+            segment.start = parseNumber(fields["start"]);
+            segment.offset = fields.count("ooffs") ? static_cast<long>(parseNumber(fields["ooffs"])) : -1;
+            segments[fields["id"]] = segment;
+            continue;
+        }
+
+        // equates are as often constants as addresses, imports repeat the export they name and
+        // cheap locals like @loop mean nothing without their scope
+        const std::string& name = fields["name"];
+        if (fields["type"] != "lab" || name.empty() || name[0] == '@' || !fields.count("val")) {
+            continue;
+        }
+        Label label;
+        label.value = parseNumber(fields["val"]);
+        label.size = fields.count("size") ? parseNumber(fields["size"]) : 1;
+        label.segment = fields["seg"];
+        label.name = name;
+        labels.push_back(label);
+    }
+
+    size_t before = symbols.size();
+    for (const Label& label : labels) {
+        if (label.value > 0xFFFF) {
+            continue;
+        }
+        Symbol symbol;
+        symbol.start = static_cast<uint16_t>(label.value);
+        symbol.end = std::min<unsigned long>(label.value + std::max<unsigned long>(label.size, 1), 0x10000);
+        symbol.bank = ANY_BANK;
+        symbol.name = label.name;
+
+        auto segment = segments.find(label.segment);
+        if (segment != segments.end() && segment->second.offset >= INES_HEADER_SIZE && label.value >= 0x8000) {
+            long prgOffset = segment->second.offset - INES_HEADER_SIZE + static_cast<long>(label.value - segment->second.start);
+            symbol.bank = static_cast<int>(prgOffset / PRG_BANK_SIZE);
+        }
+        symbols.push_back(symbol);
+    }
+    return symbols.size() > before;
+}
+
+// ld65 -Ln writes "al 00C000 .name", FCEUX .nl files are "$C000#name#comment". neither has
+// sizes, so each label runs up to the next one in the file, without leaving its bus region
+bool Symbols::loadLabels(std::istream& file) {
+    std::vector<Symbol> labels;
+    std::string line;
+    while (std::getline(file, line)) {
+        unsigned int address;
+        std::string name;
+        char label[256];
+        if (std::sscanf(line.c_str(), "al %x .%255s", &address, label) == 2) {
+            name = label;
+        } else if (std::sscanf(line.c_str(), "$%x#%255[^#\r\n]", &address, label) == 2) {
+            name = label;
+        } else {
+            continue;
+        }
+        if (address > 0xFFFF || name.empty() || name[0] == '@') {
+            continue;
+        }
+        labels.push_back({ static_cast<uint16_t>(address), address + 1, ANY_BANK, name });
+    }
+
+    std::stable_sort(labels.begin(), labels.end(), [](const Symbol& a, const Symbol& b) {
+        return a.start < b.start;
+    });
+    for (size_t i = 0; i < labels.size(); i++) {
+        Symbol& label = labels[i];
+        uint32_t next = label.end;
+        for (size_t j = i + 1; j < labels.size(); j++) {
+            if (labels[j].start != label.start) {
+                next = labels[j].start;
+                break;
+            }
+        }
+        while (label.end < next && Stats::regionOf(label.end) == Stats::regionOf(label.start)) {
+            label.end++;
+        }
+        symbols.push_back(label);
+    }
+    return !labels.empty();
+}
+
+bool Symbols::lookup(uint16_t address, std::string& name, int bank) {
+    load();
+
+    size_t after = std::upper_bound(symbols.begin(), symbols.end(), address, [](uint16_t address, const Symbol& symbol) {
+        return address < symbol.start;
+    }) - symbols.begin();
+
+    // the innermost symbol covering address wins, so a label inside a buffer names its own
+    // bytes and the buffer names the rest. with several at the same start the first loaded wins
+    const Symbol* found = nullptr;
+    for (size_t i = after; i > 0 && maxEnd[i - 1] > address; i--) {
+        const Symbol& symbol = symbols[i - 1];
+        if (found != nullptr && symbol.start != found->start) {
+            break;
+        }
+        if (address >= symbol.end) {
+            continue;
+        }
+        if (bank != ANY_BANK && symbol.bank != ANY_BANK && symbol.bank != bank) {
+            continue;
+        }
+        found = &symbol;
+    }
+    if (found == nullptr) {
+        return false;
+    }
+
+    name = found->name;
+    if (address != found->start) {
+        name += "+" + std::to_string(address - found->start);
+    }
+    return true;
+}
+
+std::string Symbols::format(uint16_t address, int digits, int bank) {
+    std::string name;
+    if (lookup(address, name, bank)) {
+        return name;
+    }
+    char hex[8];
+    std::snprintf(hex, sizeof(hex), "$%0*X", digits, address);
+    return hex;
+}
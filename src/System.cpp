@@ -1,23 +1,35 @@
 #include <System.hpp>
 
 #include <Rom.hpp>
+#include <SaveState.hpp>
+#include <Trace.hpp>
 
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <iostream>
 
-System* System::instance = nullptr;
-
-System::System(std::string romPath) {
-    instance = this;
+// a machine with nothing in the cartridge slot, used as is by the NSF player
+System::System() {
     stop = false;
     masterCycles = 0;
+    frameCount = 0;
+    instructionCount = 0;
+    draw = false;
+    frameDoneInside = false;
+    aheadAudio.reserve(APU::SAMPLE_RATE / 30);
     ppu = new PPU();
     apu = new APU();
     joypad = new Joypad();
-    bus = new Bus(ppu, apu, joypad);
+    joypad2 = new Joypad();
+    bus = new Bus(ppu, apu, joypad, joypad2, &stats);
+    apu->connectBus(bus);
     bus->Zero();
+    cpu = new CPU(bus, this);
+    cpu->powerOn();
+}
 
+System::System(std::string romPath) : System() {
     Rom::loadRom(romPath.c_str(), bus, ppu);
     // std::vector<uint8_t> data = {0x20, 0x06, 0x06, 0x20, 0x38, 0x06, 0x20, 0x0d, 0x06, 0x20, 0x2a, 0x06, 0x60, 0xa9, 0x02, 0x85,
     // 0x02, 0xa9, 0x04, 0x85, 0x03, 0xa9, 0x11, 0x85, 0x10, 0xa9, 0x10, 0x85, 0x12, 0xa9, 0x0f, 0x85,
@@ -41,8 +53,18 @@ System::System(std::string romPath) {
     // 0xea, 0xca, 0xd0, 0xfb, 0x60};
     // bus->writeBytes(0x0600, data.data(), data.size());
     // bus->writeWord(0xFFFC, 0x0600);
-    cpu = new CPU(bus);
     cpu->powerOn();
+    // copying the ROM in went through the bus, count from power on
+    stats.clear();
+}
+
+System::~System() {
+    delete cpu;
+    delete bus;
+    delete joypad;
+    delete joypad2;
+    delete apu;
+    delete ppu;
 }
 
 void System::run() {
@@ -58,26 +80,138 @@ void waitNanoSeconds(int ns) {
     }
 }
 
-void System::step() {
-    auto start = std::chrono::high_resolution_clock::now();
-    masterCycles++;
+// runs one instruction and catches the PPU up, returns true once the PPU wraps past scanline 261
+bool System::stepInstruction() {
+    size_t cyclesBefore = cpu->getCycles();
     cpu->execOnce();
+    instructionCount++;
+
     bool nmiBefore = ppu->nmiInterrupt;
-    ppu->tick(cpu->getCycles() * 3);
+    bool frameDone = frameDoneInside;
+    frameDoneInside = false;
+    // DMA stalls raised during the catch-up (a DMC fetch falling due) are
+    // charged to the CPU and clocked through before the next instruction
+    while (cpu->getCycles() != cyclesBefore) {
+        size_t elapsed = cpu->getCycles() - cyclesBefore;
+        cyclesBefore = cpu->getCycles();
+        masterCycles += elapsed;
+        apu->tick(elapsed);
+        frameDone |= ppu->tick(elapsed * 3);
+        cpu->stall(bus->takeStallCycles());
+    }
     bool nmiAfter = ppu->nmiInterrupt;
 
     if (!nmiBefore && nmiAfter) {
         draw = true;
     }
 
+    if (frameDone) {
+        frameCount++;
+        STAT(if (ppu->renderFrames) stats.framesRendered++);
+    }
+    return frameDone;
+}
+
+void System::step() {
+    auto start = std::chrono::high_resolution_clock::now();
+    stepInstruction();
+
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
     waitNanoSeconds(558 - duration);
 }
 
-void System::stepThisAndPPU(uint8_t cycles) {
+FrameView System::runFrame() {
+    apu->clearSamples();
+    {
+        // the PPU is caught up after every instruction, so rendering shows up nested in here
+        TRACE_SCOPE("cpu");
+        while (!stop && !stepInstruction()) {
+        }
+    }
+    {
+        TRACE_SCOPE("audio mix");
+        apu->endFrame();
+    }
+
+    return FrameView {
+        ppu->frameBuffer,
+        apu->getSamples(),
+        apu->getSampleCount(),
+        frameCount
+    };
+}
+
+FrameView System::runFrameAhead(int aheadFrames) {
+    if (aheadFrames <= 0) {
+        return runFrame();
+    }
+
+    TRACE_SCOPE("run ahead");
+    ppu->renderFrames = false;
+    FrameView real = runFrame();
+    aheadAudio.assign(real.audio, real.audio + real.audioSamples);
+
+    uint8_t state[SAVESTATE_SIZE];
+    size_t size = saveState(state, sizeof(state));
+    if (size == 0) {
+        ppu->renderFrames = true;
+        return real;
+    }
+
+    Profiler* profiler = cpu->profiler;
+    Coverage* coverage = bus->coverage;
+    cpu->profiler = nullptr;
+    bus->coverage = nullptr;
+    uint64_t instructions = instructionCount;
+    if (Stats::ENABLED) {
+        realStats = stats;
+    }
+
+    for (int i = 1; i <= aheadFrames && !stop; i++) {
+        ppu->renderFrames = i == aheadFrames;
+        runFrame();
+    }
+    ppu->renderFrames = true;
+    loadState(state, size);
+
+    cpu->profiler = profiler;
+    bus->coverage = coverage;
+    instructionCount = instructions;
+    if (Stats::ENABLED) {
+        // the picture handed back was still drawn, just by the last frame ahead
+        stats = realStats;
+        stats.framesRendered++;
+    }
+
+    return FrameView {
+        ppu->frameBuffer,
+        aheadAudio.data(),
+        aheadAudio.size(),
+        frameCount
+    };
+}
+
+bool System::stepThisAndPPU(uint8_t cycles) {
     masterCycles += cycles;
-    ppu->tick(cycles * 3);
+    apu->tick(cycles);
+    bool frameDone = ppu->tick(cycles * 3);
+    frameDoneInside |= frameDone;
+    return frameDone;
+}
+
+void System::reset() {
+    apu->writeStatus(0x00);
+    ppu->writeToControlRegister(0x00);
+    ppu->writeToMaskRegister(0x00);
+    cpu->reset();
+}
+
+void System::power() {
+    bus->clearRam();
+    ppu->reset();
+    apu->reset();
+    cpu->powerOn();
 }
 
 bool System::needsDraw() {
@@ -86,4 +220,74 @@ bool System::needsDraw() {
         return true;
     }
     return false;
+}
+
+static const char SAVESTATE_MAGIC[4] = {'N', 'E', 'S', 'S'};
+
+size_t System::saveState(uint8_t* buffer, size_t capacity) const {
+    StateWriter state(buffer, capacity);
+    state.writeBytes(SAVESTATE_MAGIC, sizeof(SAVESTATE_MAGIC));
+    state.write(SAVESTATE_VERSION);
+    // payload size, patched in below
+    state.write(static_cast<uint32_t>(0));
+    size_t headerSize = state.size();
+
+    cpu->saveState(state);
+    bus->saveState(state);
+    ppu->saveState(state);
+    apu->saveState(state);
+    joypad->saveState(state);
+    joypad2->saveState(state);
+    state.write(masterCycles);
+    state.write(frameCount);
+    state.write(draw);
+
+    if (state.failed()) {
+        std::cerr << "Savestate does not fit in " << capacity << " bytes" << std::endl;
+        return 0;
+    }
+
+    uint32_t payloadSize = static_cast<uint32_t>(state.size() - headerSize);
+    std::memcpy(buffer + headerSize - sizeof(payloadSize), &payloadSize, sizeof(payloadSize));
+    return state.size();
+}
+
+bool System::loadState(const uint8_t* buffer, size_t size) {
+    StateReader state(buffer, size);
+    char magic[4];
+    uint32_t version;
+    uint32_t payloadSize;
+    state.readBytes(magic, sizeof(magic));
+    state.read(version);
+    state.read(payloadSize);
+
+    // check everything that can be checked before touching the machine
+    if (state.failed() || std::memcmp(magic, SAVESTATE_MAGIC, sizeof(magic)) != 0) {
+        std::cerr << "Not a savestate" << std::endl;
+        return false;
+    }
+    if (version != SAVESTATE_VERSION) {
+        std::cerr << "Savestate version " << version << " is not supported" << std::endl;
+        return false;
+    }
+    if (payloadSize != state.remaining()) {
+        std::cerr << "Savestate is truncated" << std::endl;
+        return false;
+    }
+
+    cpu->loadState(state);
+    bus->loadState(state);
+    ppu->loadState(state);
+    apu->loadState(state);
+    joypad->loadState(state);
+    joypad2->loadState(state);
+    state.read(masterCycles);
+    state.read(frameCount);
+    state.read(draw);
+
+    if (state.failed() || state.remaining() != 0) {
+        std::cerr << "Savestate layout does not match this build" << std::endl;
+        return false;
+    }
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include <TestRom.hpp>
+
+#define TEST_STATUS 0x6000
+#define TEST_SIGNATURE 0x6001
+#define TEST_TEXT 0x6004
+#define TEST_TEXT_END 0x7FFF
+
+#define STATUS_RUNNING 0x80
+#define STATUS_NEEDS_RESET 0x81
+
+TestRom::TestRom() {
+    status = Status::WAITING;
+    resultCode = 0;
+    resetCountdown = 0;
+}
+
+TestRom::Status TestRom::update(System* system) {
+    if (status == Status::PASSED || status == Status::FAILED) {
+        return status;
+    }
+
+    Bus* bus = system->bus;
+    if (bus->peek(TEST_SIGNATURE) != 0xDE || bus->peek(TEST_SIGNATURE + 1) != 0xB0 || bus->peek(TEST_SIGNATURE + 2) != 0x61) {
+        return status;
+    }
+    status = Status::RUNNING;
+
+    uint8_t code = bus->peek(TEST_STATUS);
+    if (code == STATUS_NEEDS_RESET) {
+        if (++resetCountdown >= RESET_DELAY_FRAMES) {
+            resetCountdown = 0;
+            system->reset();
+        }
+    } else if (code < STATUS_RUNNING) {
+        resultCode = code;
+        status = code == 0 ? Status::PASSED : Status::FAILED;
+    }
+    return status;
+}
+
+uint8_t TestRom::getResultCode() const {
+    return resultCode;
+}
+
+std::string TestRom::readText(System* system) {
+    std::string text;
+    for (uint16_t address = TEST_TEXT; address <= TEST_TEXT_END; address++) {
+        uint8_t c = system->bus->peek(address);
+        if (c == 0) {
+            break;
+        }
+        text += static_cast<char>(c);
+    }
+    return text;
+}
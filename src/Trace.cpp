@@ -0,0 +1,123 @@
+#include <Trace.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <vector>
+
+std::atomic<Tracer*> Tracer::active(nullptr);
+
+// small ids so the viewer lists threads in the order they first recorded something
+static uint32_t currentThread() {
+    static std::atomic<uint32_t> nextThread(1);
+    thread_local uint32_t thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+Tracer::Tracer(size_t capacity) {
+    this->capacity = capacity > 0 ? capacity : 1;
+    events = new Event[this->capacity];
+    count = 0;
+    next = 0;
+    for (uint32_t i = 0; i < MAX_THREADS; i++) {
+        threadNames[i] = nullptr;
+    }
+    epoch = std::chrono::steady_clock::now();
+}
+
+Tracer::~Tracer() {
+    if (getActive() == this) {
+        setActive(nullptr);
+    }
+    delete[] events;
+}
+
+void Tracer::setActive(Tracer* tracer) {
+    active.store(tracer, std::memory_order_release);
+}
+
+Tracer* Tracer::getActive() {
+    return active.load(std::memory_order_acquire);
+}
+
+uint64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::record(const char* name, uint64_t start, uint64_t end) {
+    uint32_t thread = currentThread();
+    std::lock_guard<std::mutex> guard(lock);
+    events[next] = { name, start, end - start, thread };
+    next = (next + 1) % capacity;
+    if (count < capacity) {
+        count++;
+    }
+}
+
+void Tracer::nameThread(const char* name) {
+    uint32_t thread = currentThread();
+    std::lock_guard<std::mutex> guard(lock);
+    if (thread < MAX_THREADS) {
+        threadNames[thread] = name;
+    }
+}
+
+bool Tracer::write(const char* path) {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not write trace: " << path << std::endl;
+        return false;
+    }
+
+    // copied out oldest first, so recording threads only wait for the copy and not the formatting
+    std::vector<Event> snapshot;
+    const char* names[MAX_THREADS];
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        snapshot.reserve(count);
+        size_t oldest = (next + capacity - count) % capacity;
+        for (size_t i = 0; i < count; i++) {
+            snapshot.push_back(events[(oldest + i) % capacity]);
+        }
+        for (uint32_t i = 0; i < MAX_THREADS; i++) {
+            names[i] = threadNames[i];
+        }
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (uint32_t i = 0; i < MAX_THREADS; i++) {
+        if (names[i] != nullptr) {
+            file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << i
+                 << ", \"args\": {\"name\": \"" << names[i] << "\"}}";
+            first = false;
+        }
+    }
+
+    // timestamps are in microseconds, keep the nanoseconds as decimals
+    char line[160];
+    for (const Event& event : snapshot) {
+        std::snprintf(line, sizeof(line), "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %llu.%03llu, \"dur\": %llu.%03llu}",
+                      event.name, event.thread,
+                      static_cast<unsigned long long>(event.start / 1000), static_cast<unsigned long long>(event.start % 1000),
+                      static_cast<unsigned long long>(event.duration / 1000), static_cast<unsigned long long>(event.duration % 1000));
+        file << (first ? "" : ",\n") << line;
+        first = false;
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+TraceScope::TraceScope(const char* name) {
+    tracer = Tracer::getActive();
+    if (tracer != nullptr) {
+        this->name = name;
+        start = tracer->now();
+    }
+}
+
+TraceScope::~TraceScope() {
+    if (tracer != nullptr) {
+        tracer->record(name, start, tracer->now());
+    }
+}
@@ -0,0 +1,84 @@
+#include <WavWriter.hpp>
+
+WavWriter::WavWriter(const char* path, int sampleRate, int channels) {
+    this->sampleRate = sampleRate;
+    this->channels = channels;
+    dataBytes = 0;
+
+    file.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (file.is_open()) {
+        writeHeader();
+    }
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::isOpen() const {
+    return file.is_open();
+}
+
+void WavWriter::write(const int16_t* samples, size_t count) {
+    if (!file.is_open()) {
+        return;
+    }
+    // little endian regardless of the host, converted in chunks to keep stream calls rare
+    char bytes[2048];
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t sample = static_cast<uint16_t>(samples[i]);
+        bytes[used++] = static_cast<char>(sample & 0xFF);
+        bytes[used++] = static_cast<char>(sample >> 8);
+        if (used == sizeof(bytes)) {
+            file.write(bytes, used);
+            used = 0;
+        }
+    }
+    file.write(bytes, used);
+    dataBytes += count * sizeof(int16_t);
+}
+
+void WavWriter::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    file.seekp(0);
+    writeHeader();
+    file.close();
+}
+
+uint64_t WavWriter::getSampleCount() const {
+    return dataBytes / sizeof(int16_t);
+}
+
+void WavWriter::writeHeader() {
+    // sizes saturate for files past 4GB, most readers then fall back to the file length
+    uint32_t dataSize = dataBytes > 0xFFFFFFFF - 36 ? 0xFFFFFFFF - 36 : static_cast<uint32_t>(dataBytes);
+
+    file.write("RIFF", 4);
+    writeU32(36 + dataSize);
+    file.write("WAVE", 4);
+
+    file.write("fmt ", 4);
+    writeU32(16);
+    writeU16(1);
+    writeU16(channels);
+    writeU32(sampleRate);
+    writeU32(sampleRate * channels * sizeof(int16_t));
+    writeU16(channels * sizeof(int16_t));
+    writeU16(16);
+
+    file.write("data", 4);
+    writeU32(dataSize);
+}
+
+void WavWriter::writeU16(uint16_t value) {
+    char bytes[2] = { static_cast<char>(value & 0xFF), static_cast<char>(value >> 8) };
+    file.write(bytes, 2);
+}
+
+void WavWriter::writeU32(uint32_t value) {
+    writeU16(value & 0xFFFF);
+    writeU16(value >> 16);
+}
@@ -0,0 +1,140 @@
+#include <apu/BlipBuffer.hpp>
+#include <SaveState.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+int16_t BlipBuffer::kernel[PHASES][KERNEL_WIDTH];
+
+BlipBuffer::BlipBuffer() {
+    buffer = new int32_t[CAPACITY + KERNEL_WIDTH];
+    factor = 0;
+    integrator = 0;
+    // the kernel is shared by every machine, build it once even when they start on several threads
+    static std::once_flag kernelBuilt;
+    std::call_once(kernelBuilt, buildKernel);
+    clear();
+}
+
+BlipBuffer::~BlipBuffer() {
+    delete[] buffer;
+}
+
+// windowed sinc impulses at PHASES sub-sample offsets, each phase sums to exactly 1 << KERNEL_BITS
+void BlipBuffer::buildKernel() {
+    const double cutoff = 0.9;
+    for (int phase = 0; phase < PHASES; phase++) {
+        double taps[KERNEL_WIDTH];
+        double sum = 0;
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            double x = i - KERNEL_WIDTH / 2 + 1 - static_cast<double>(phase) / PHASES;
+            double angle = M_PI * cutoff * x;
+            double sinc = x == 0 ? 1.0 : std::sin(angle) / angle;
+            double window = 0.42 + 0.5 * std::cos(M_PI * x / (KERNEL_WIDTH / 2)) + 0.08 * std::cos(2 * M_PI * x / (KERNEL_WIDTH / 2));
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+
+        int total = 0;
+        int largest = 0;
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            kernel[phase][i] = static_cast<int16_t>(std::lround(taps[i] / sum * (1 << KERNEL_BITS)));
+            total += kernel[phase][i];
+            if (kernel[phase][i] > kernel[phase][largest]) {
+                largest = i;
+            }
+        }
+        kernel[phase][largest] += (1 << KERNEL_BITS) - total;
+    }
+}
+
+void BlipBuffer::setRates(double clockRate, double sampleRate) {
+    factor = static_cast<uint64_t>(sampleRate / clockRate * 4294967296.0 + 0.5);
+}
+
+void BlipBuffer::clear() {
+    offset = 0;
+    integrator = 0;
+    std::memset(buffer, 0, (CAPACITY + KERNEL_WIDTH) * sizeof(int32_t));
+}
+
+void BlipBuffer::addDelta(uint32_t clockTime, int32_t delta) {
+    uint64_t position = offset + clockTime * factor;
+    size_t index = position >> 32;
+    if (index >= CAPACITY) {
+        return;
+    }
+
+    const int16_t* taps = kernel[(position >> (32 - PHASE_BITS)) & (PHASES - 1)];
+    int32_t* out = buffer + index;
+    for (int i = 0; i < KERNEL_WIDTH; i++) {
+        out[i] += taps[i] * delta;
+    }
+}
+
+void BlipBuffer::endFrame(uint32_t clockDuration) {
+    offset += clockDuration * factor;
+    if ((offset >> 32) > CAPACITY) {
+        offset = static_cast<uint64_t>(CAPACITY) << 32;
+    }
+}
+
+size_t BlipBuffer::samplesAvailable() const {
+    return offset >> 32;
+}
+
+size_t BlipBuffer::readSamples(int16_t* out, size_t count) {
+    if (count > samplesAvailable()) {
+        count = samplesAvailable();
+    }
+
+    // integrating the deltas gives the band-limited waveform, leaking the integrator removes DC
+    int32_t sum = integrator;
+    for (size_t i = 0; i < count; i++) {
+        sum += buffer[i];
+        int32_t sample = sum >> KERNEL_BITS;
+        if (sample > 32767) {
+            sample = 32767;
+        } else if (sample < -32768) {
+            sample = -32768;
+        }
+        out[i] = static_cast<int16_t>(sample);
+        sum -= sum >> BASS_SHIFT;
+    }
+    integrator = sum;
+
+    size_t remaining = samplesAvailable() - count + KERNEL_WIDTH;
+    std::memmove(buffer, buffer + count, remaining * sizeof(int32_t));
+    std::memset(buffer + remaining, 0, count * sizeof(int32_t));
+    offset -= static_cast<uint64_t>(count) << 32;
+
+    return count;
+}
+
+void BlipBuffer::saveState(StateWriter& state, uint32_t clockTime) const {
+    uint64_t position = offset + clockTime * factor;
+    size_t index = position >> 32;
+    if (index > CAPACITY) {
+        index = CAPACITY;
+    }
+
+    int32_t level = integrator;
+    for (size_t i = 0; i < index; i++) {
+        level += buffer[i];
+    }
+    uint32_t fraction = static_cast<uint32_t>(position);
+
+    state.write(fraction);
+    state.write(level);
+    state.writeBytes(buffer + index, KERNEL_WIDTH * sizeof(int32_t));
+}
+
+void BlipBuffer::loadState(StateReader& state) {
+    clear();
+    uint32_t fraction;
+    state.read(fraction);
+    state.read(integrator);
+    state.readBytes(buffer, KERNEL_WIDTH * sizeof(int32_t));
+    offset = fraction;
+}
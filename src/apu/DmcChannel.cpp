@@ -0,0 +1,179 @@
+#include <apu/DmcChannel.hpp>
+
+#include <Bus.hpp>
+#include <Coverage.hpp>
+#include <SaveState.hpp>
+
+DmcChannel::DmcChannel() {
+    bus = nullptr;
+    init();
+}
+
+DmcChannel::~DmcChannel() {
+}
+
+void DmcChannel::init() {
+    irqEnabled = false;
+    irqFlag = false;
+    loop = false;
+    timer = rateTable[0];
+    currentTimer = timer;
+    outputLevel = 0;
+    sampleAddress = 0xC000;
+    sampleLength = 1;
+    currentAddress = 0xC000;
+    bytesRemaining = 0;
+    sampleBuffer = 0;
+    sampleBufferEmpty = true;
+    shiftRegister = 0;
+    bitsRemaining = 8;
+    silence = true;
+}
+
+void DmcChannel::connectBus(Bus* bus) {
+    this->bus = bus;
+}
+
+void DmcChannel::writeControl(uint8_t data) {
+    irqEnabled = data & 0x80;
+    loop = data & 0x40;
+    timer = rateTable[data & 0x0F];
+    if (!irqEnabled) {
+        irqFlag = false;
+    }
+}
+
+void DmcChannel::writeDirectLoad(uint8_t data) {
+    outputLevel = data & 0x7F;
+}
+
+void DmcChannel::writeSampleAddress(uint8_t data) {
+    sampleAddress = 0xC000 | (static_cast<uint16_t>(data) << 6);
+}
+
+void DmcChannel::writeSampleLength(uint8_t data) {
+    sampleLength = (static_cast<uint16_t>(data) << 4) | 1;
+}
+
+void DmcChannel::setEnabled(bool enabled) {
+    irqFlag = false;
+    if (!enabled) {
+        bytesRemaining = 0;
+    } else if (bytesRemaining == 0) {
+        restart();
+        fetchSample();
+    }
+}
+
+bool DmcChannel::isActive() const {
+    return bytesRemaining > 0;
+}
+
+void DmcChannel::restart() {
+    currentAddress = sampleAddress;
+    bytesRemaining = sampleLength;
+}
+
+void DmcChannel::fetchSample() {
+    if (!sampleBufferEmpty || bytesRemaining == 0 || bus == nullptr) {
+        return;
+    }
+
+    sampleBuffer = bus->read(currentAddress, Coverage::SAMPLE);
+    bus->stall(DMA_STALL_CYCLES);
+    STAT(bus->stats->dmcDmas++);
+    sampleBufferEmpty = false;
+    currentAddress = currentAddress == 0xFFFF ? 0x8000 : currentAddress + 1;
+    bytesRemaining--;
+
+    if (bytesRemaining == 0) {
+        if (loop) {
+            restart();
+        } else if (irqEnabled) {
+            irqFlag = true;
+        }
+    }
+}
+
+void DmcChannel::run(uint32_t cycles) {
+    while (cycles >= currentTimer) {
+        cycles -= currentTimer;
+        currentTimer = timer;
+        clockOutput();
+    }
+    currentTimer -= cycles;
+}
+
+uint32_t DmcChannel::cyclesUntilFetch() const {
+    if (bytesRemaining == 0) {
+        return UINT32_MAX;
+    }
+    return currentTimer + (bitsRemaining - 1) * timer;
+}
+
+void DmcChannel::clockOutput() {
+    if (!silence) {
+        if (shiftRegister & 0x1) {
+            if (outputLevel <= 125) {
+                outputLevel += 2;
+            }
+        } else if (outputLevel >= 2) {
+            outputLevel -= 2;
+        }
+    }
+    shiftRegister >>= 1;
+
+    if (--bitsRemaining == 0) {
+        bitsRemaining = 8;
+        silence = sampleBufferEmpty;
+        if (!sampleBufferEmpty) {
+            shiftRegister = sampleBuffer;
+            sampleBufferEmpty = true;
+            fetchSample();
+        }
+    }
+}
+
+uint8_t DmcChannel::output() const {
+    return outputLevel;
+}
+
+const uint16_t DmcChannel::rateTable[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+};
+
+void DmcChannel::saveState(StateWriter& state) const {
+    state.write(irqEnabled);
+    state.write(irqFlag);
+    state.write(loop);
+    state.write(currentTimer);
+    state.write(timer);
+    state.write(outputLevel);
+    state.write(sampleAddress);
+    state.write(sampleLength);
+    state.write(currentAddress);
+    state.write(bytesRemaining);
+    state.write(sampleBuffer);
+    state.write(sampleBufferEmpty);
+    state.write(shiftRegister);
+    state.write(bitsRemaining);
+    state.write(silence);
+}
+
+void DmcChannel::loadState(StateReader& state) {
+    state.read(irqEnabled);
+    state.read(irqFlag);
+    state.read(loop);
+    state.read(currentTimer);
+    state.read(timer);
+    state.read(outputLevel);
+    state.read(sampleAddress);
+    state.read(sampleLength);
+    state.read(currentAddress);
+    state.read(bytesRemaining);
+    state.read(sampleBuffer);
+    state.read(sampleBufferEmpty);
+    state.read(shiftRegister);
+    state.read(bitsRemaining);
+    state.read(silence);
+}
@@ -0,0 +1,141 @@
+#include <apu/NoiseChannel.hpp>
+#include <SaveState.hpp>
+#include <apu/LengthTable.hpp>
+
+NoiseChannel::NoiseChannel() {
+    init();
+}
+
+NoiseChannel::~NoiseChannel() {
+}
+
+void NoiseChannel::init() {
+    lengthTimerHalt = false;
+    constantVolume = false;
+    volume = 0;
+    mode = false;
+    timer = periodTable[0];
+    currentTimer = timer;
+    lengthCounter = 0;
+    shiftRegister = 1;
+    enabled = false;
+    envelopeStart = false;
+    envelopeDivider = 0;
+    envelopeDecay = 0;
+}
+
+void NoiseChannel::writeVolume(uint8_t data) {
+    lengthTimerHalt = data & 0x20;
+    constantVolume = data & 0x10;
+    volume = data & 0x0F;
+}
+
+void NoiseChannel::writePeriod(uint8_t data) {
+    mode = data & 0x80;
+    timer = periodTable[data & 0x0F];
+}
+
+void NoiseChannel::writeLength(uint8_t length) {
+    if (enabled) {
+        lengthCounter = apu::lengthTable[length >> 3];
+    }
+    envelopeStart = true;
+}
+
+void NoiseChannel::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (!enabled) {
+        lengthCounter = 0;
+    }
+}
+
+void NoiseChannel::run(uint32_t cycles) {
+    if (cycles < currentTimer) {
+        currentTimer -= cycles;
+        return;
+    }
+
+    cycles -= currentTimer;
+    uint32_t reloads = 1 + cycles / timer;
+    currentTimer = timer - cycles % timer;
+
+    // the shift register keeps running while the channel is silent, like on hardware, so the
+    // noise picks up in the right phase once it's heard again. only the APU's stepping skips
+    // the edges of an idle channel, since they don't change the output
+    for (uint32_t i = 0; i < reloads; i++) {
+        uint16_t feedback = (shiftRegister ^ (shiftRegister >> (mode ? 6 : 1))) & 0x1;
+        shiftRegister = (shiftRegister >> 1) | (feedback << 14);
+    }
+}
+
+uint32_t NoiseChannel::period() const {
+    return timer;
+}
+
+bool NoiseChannel::idle() const {
+    return lengthCounter == 0 || (constantVolume ? volume : envelopeDecay) == 0;
+}
+
+void NoiseChannel::clockEnvelope() {
+    if (envelopeStart) {
+        envelopeStart = false;
+        envelopeDecay = 15;
+        envelopeDivider = volume;
+    } else if (envelopeDivider == 0) {
+        envelopeDivider = volume;
+        if (envelopeDecay > 0) {
+            envelopeDecay--;
+        } else if (lengthTimerHalt) {
+            envelopeDecay = 15;
+        }
+    } else {
+        envelopeDivider--;
+    }
+}
+
+void NoiseChannel::clockLength() {
+    if (lengthCounter > 0 && !lengthTimerHalt) {
+        lengthCounter--;
+    }
+}
+
+uint8_t NoiseChannel::output() const {
+    if (lengthCounter == 0 || (shiftRegister & 0x1)) {
+        return 0;
+    }
+    return constantVolume ? volume : envelopeDecay;
+}
+
+const uint16_t NoiseChannel::periodTable[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+};
+
+void NoiseChannel::saveState(StateWriter& state) const {
+    state.write(lengthTimerHalt);
+    state.write(constantVolume);
+    state.write(volume);
+    state.write(mode);
+    state.write(currentTimer);
+    state.write(timer);
+    state.write(lengthCounter);
+    state.write(shiftRegister);
+    state.write(enabled);
+    state.write(envelopeStart);
+    state.write(envelopeDivider);
+    state.write(envelopeDecay);
+}
+
+void NoiseChannel::loadState(StateReader& state) {
+    state.read(lengthTimerHalt);
+    state.read(constantVolume);
+    state.read(volume);
+    state.read(mode);
+    state.read(currentTimer);
+    state.read(timer);
+    state.read(lengthCounter);
+    state.read(shiftRegister);
+    state.read(enabled);
+    state.read(envelopeStart);
+    state.read(envelopeDivider);
+    state.read(envelopeDecay);
+}
@@ -1,35 +1,43 @@
 #include <apu/PulseChannel.hpp>
+#include <SaveState.hpp>
+#include <apu/LengthTable.hpp>
 
-PulseChannel::PulseChannel() {
+PulseChannel::PulseChannel(bool onesComplementSweep) {
+    this->onesComplementSweep = onesComplementSweep;
+    init();
+}
+
+PulseChannel::~PulseChannel() {
+    // Nothing to do here
+}
+
+void PulseChannel::init() {
     // Initialize all variables to 0
     dutyCycle = 0;
     lengthTimerHalt = false;
     constantVolume = false;
     volume = 0;
-    currentTimer = 0;
     timer = 0;
+    currentTimer = period();
     lengthCounter = 0;
     divider = 0;
     sweepEnabled = false;
     sweepPeriod = 0;
     sweepNegate = false;
     sweepShift = 0;
-}
-
-PulseChannel::~PulseChannel() {
-    // Nothing to do here
-}
-
-void PulseChannel::init() {
-    currentTimer = 0;
-    timer = 0;
+    enabled = false;
+    dutyStep = 0;
+    sweepReload = false;
+    envelopeStart = false;
+    envelopeDivider = 0;
+    envelopeDecay = 0;
 }
 
 void PulseChannel::writeDuty(uint8_t duty) {
     dutyCycle = (duty & 0xC0) >> 6;
     lengthTimerHalt = duty & 0x20;
     constantVolume = duty & 0x10;
-    volume = duty & 0x07;
+    volume = duty & 0x0F;
 }
 
 void PulseChannel::writeSweep(uint8_t sweep) {
@@ -37,16 +45,101 @@ void PulseChannel::writeSweep(uint8_t sweep) {
     sweepPeriod = (sweep & 0x70) >> 4;
     sweepNegate = sweep & 0x08;
     sweepShift = sweep & 0x07;
+    sweepReload = true;
 }
 
 void PulseChannel::writeTimerLow(uint8_t timerLow) {
-    timer |= timerLow;
+    timer = (timer & 0x700) | timerLow;
 }
 
 void PulseChannel::writeLength(uint8_t length) {
     timer = (timer & 0xff) | ((length & 0x7) << 8);
-    lengthCounter = length >> 3;
-    currentTimer = timer;
+    if (enabled) {
+        lengthCounter = apu::lengthTable[length >> 3];
+    }
+    dutyStep = 0;
+    envelopeStart = true;
+}
+
+void PulseChannel::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (!enabled) {
+        lengthCounter = 0;
+    }
+}
+
+void PulseChannel::run(uint32_t cycles) {
+    if (cycles < currentTimer) {
+        currentTimer -= cycles;
+        return;
+    }
+
+    cycles -= currentTimer;
+    uint32_t period = this->period();
+    uint32_t reloads = 1 + cycles / period;
+    currentTimer = period - cycles % period;
+    dutyStep = (dutyStep + reloads) & 0x7;
+}
+
+// the timer is clocked every other CPU cycle
+uint32_t PulseChannel::period() const {
+    return (timer + 1) * 2;
+}
+
+bool PulseChannel::idle() const {
+    return lengthCounter == 0 || timer < 8 || sweepTarget() > 0x7FF || (constantVolume ? volume : envelopeDecay) == 0;
+}
+
+void PulseChannel::clockEnvelope() {
+    if (envelopeStart) {
+        envelopeStart = false;
+        envelopeDecay = 15;
+        envelopeDivider = volume;
+    } else if (envelopeDivider == 0) {
+        envelopeDivider = volume;
+        if (envelopeDecay > 0) {
+            envelopeDecay--;
+        } else if (lengthTimerHalt) {
+            envelopeDecay = 15;
+        }
+    } else {
+        envelopeDivider--;
+    }
+}
+
+void PulseChannel::clockLengthAndSweep() {
+    if (lengthCounter > 0 && !lengthTimerHalt) {
+        lengthCounter--;
+    }
+
+    uint16_t target = sweepTarget();
+    if (divider == 0 && sweepEnabled && sweepShift > 0 && timer >= 8 && target <= 0x7FF) {
+        timer = target;
+    }
+    if (divider == 0 || sweepReload) {
+        divider = sweepPeriod;
+        sweepReload = false;
+    } else {
+        divider--;
+    }
+}
+
+uint16_t PulseChannel::sweepTarget() const {
+    uint16_t change = timer >> sweepShift;
+    if (!sweepNegate) {
+        return timer + change;
+    }
+    if (onesComplementSweep) {
+        change++;
+    }
+    return change > timer ? 0 : timer - change;
+}
+
+uint8_t PulseChannel::output() const {
+    if (lengthCounter == 0 || timer < 8 || sweepTarget() > 0x7FF || !dutyTable[dutyCycle][dutyStep]) {
+        return 0;
+    }
+    return constantVolume ? volume : envelopeDecay;
 }
 
 const uint8_t PulseChannel::dutyTable[4][8] = {
@@ -54,4 +147,46 @@ const uint8_t PulseChannel::dutyTable[4][8] = {
     { 0, 0, 0, 0, 0, 0, 1, 1 },
     { 0, 0, 0, 0, 1, 1, 1, 1 },
     { 1, 1, 1, 1, 1, 1, 0, 0 },
-};
\ No newline at end of file
+};
+
+void PulseChannel::saveState(StateWriter& state) const {
+    state.write(dutyCycle);
+    state.write(lengthTimerHalt);
+    state.write(constantVolume);
+    state.write(volume);
+    state.write(currentTimer);
+    state.write(timer);
+    state.write(lengthCounter);
+    state.write(divider);
+    state.write(sweepEnabled);
+    state.write(sweepPeriod);
+    state.write(sweepNegate);
+    state.write(sweepShift);
+    state.write(enabled);
+    state.write(dutyStep);
+    state.write(sweepReload);
+    state.write(envelopeStart);
+    state.write(envelopeDivider);
+    state.write(envelopeDecay);
+}
+
+void PulseChannel::loadState(StateReader& state) {
+    state.read(dutyCycle);
+    state.read(lengthTimerHalt);
+    state.read(constantVolume);
+    state.read(volume);
+    state.read(currentTimer);
+    state.read(timer);
+    state.read(lengthCounter);
+    state.read(divider);
+    state.read(sweepEnabled);
+    state.read(sweepPeriod);
+    state.read(sweepNegate);
+    state.read(sweepShift);
+    state.read(enabled);
+    state.read(dutyStep);
+    state.read(sweepReload);
+    state.read(envelopeStart);
+    state.read(envelopeDivider);
+    state.read(envelopeDecay);
+}
@@ -0,0 +1,120 @@
+#include <apu/TriangleChannel.hpp>
+#include <SaveState.hpp>
+#include <apu/LengthTable.hpp>
+
+TriangleChannel::TriangleChannel() {
+    init();
+}
+
+TriangleChannel::~TriangleChannel() {
+}
+
+void TriangleChannel::init() {
+    control = false;
+    linearReload = 0;
+    linearCounter = 0;
+    linearReloadFlag = false;
+    timer = 0;
+    currentTimer = period();
+    lengthCounter = 0;
+    enabled = false;
+    sequenceStep = 0;
+}
+
+void TriangleChannel::writeLinearCounter(uint8_t data) {
+    control = data & 0x80;
+    linearReload = data & 0x7F;
+}
+
+void TriangleChannel::writeTimerLow(uint8_t timerLow) {
+    timer = (timer & 0x700) | timerLow;
+}
+
+void TriangleChannel::writeLength(uint8_t length) {
+    timer = (timer & 0xff) | ((length & 0x7) << 8);
+    if (enabled) {
+        lengthCounter = apu::lengthTable[length >> 3];
+    }
+    linearReloadFlag = true;
+}
+
+void TriangleChannel::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (!enabled) {
+        lengthCounter = 0;
+    }
+}
+
+void TriangleChannel::run(uint32_t cycles) {
+    if (cycles < currentTimer) {
+        currentTimer -= cycles;
+        return;
+    }
+
+    cycles -= currentTimer;
+    uint32_t period = this->period();
+    uint32_t reloads = 1 + cycles / period;
+    currentTimer = period - cycles % period;
+    if (!idle()) {
+        sequenceStep = (sequenceStep + reloads) & 0x1F;
+    }
+}
+
+uint32_t TriangleChannel::period() const {
+    return timer + 1;
+}
+
+// periods below 2 are ultrasonic, hold the level instead of aliasing
+bool TriangleChannel::idle() const {
+    return lengthCounter == 0 || linearCounter == 0 || timer < 2;
+}
+
+void TriangleChannel::clockLinearCounter() {
+    if (linearReloadFlag) {
+        linearCounter = linearReload;
+    } else if (linearCounter > 0) {
+        linearCounter--;
+    }
+    if (!control) {
+        linearReloadFlag = false;
+    }
+}
+
+void TriangleChannel::clockLength() {
+    if (lengthCounter > 0 && !control) {
+        lengthCounter--;
+    }
+}
+
+uint8_t TriangleChannel::output() const {
+    return sequence[sequenceStep];
+}
+
+const uint8_t TriangleChannel::sequence[32] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+void TriangleChannel::saveState(StateWriter& state) const {
+    state.write(control);
+    state.write(linearReload);
+    state.write(linearCounter);
+    state.write(linearReloadFlag);
+    state.write(currentTimer);
+    state.write(timer);
+    state.write(lengthCounter);
+    state.write(enabled);
+    state.write(sequenceStep);
+}
+
+void TriangleChannel::loadState(StateReader& state) {
+    state.read(control);
+    state.read(linearReload);
+    state.read(linearCounter);
+    state.read(linearReloadFlag);
+    state.read(currentTimer);
+    state.read(timer);
+    state.read(lengthCounter);
+    state.read(enabled);
+    state.read(sequenceStep);
+}
@@ -0,0 +1,365 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+
+#include <System.hpp>
+#include <Movie.hpp>
+#include <FrameHash.hpp>
+#include <TestRom.hpp>
+#include <Rom.hpp>
+#include <Json.hpp>
+
+void printUsage() {
+    std::cerr << "usage: batch [--threads N] [--test] <jobs.txt | - | directory>" << std::endl;
+    std::cerr << "  every line of the job list is \"rom movie frames\", movie may be - for no input and" << std::endl;
+    std::cerr << "  frames may be left out to run the whole movie (600 without one). lines starting with #" << std::endl;
+    std::cerr << "  are skipped. a directory runs every .nes file under it with no input" << std::endl;
+    std::cerr << "  --test  treat every ROM as a blargg style test that reports through $6000, it ends when" << std::endl;
+    std::cerr << "          the ROM does or after frames (3600 by default)" << std::endl;
+    std::cerr << "  one JSON object per job is printed as each one finishes" << std::endl;
+}
+
+struct Job {
+    std::string rom;
+    std::string movie;
+    uint64_t frames;
+};
+
+struct JobResult {
+    uint64_t frames;
+    uint64_t instructions;
+    double seconds;
+    FrameHash hash;
+    // "ok", "stopped" when the CPU hit an illegal opcode, or "error". test jobs end up
+    // "passed", "failed" or "timeout" instead of "ok"
+    const char* status;
+    std::string error;
+    uint8_t testCode;
+    std::string testText;
+};
+
+// with --test the frame count becomes a timeout
+static bool testMode = false;
+
+bool loadJobs(std::istream& in, std::vector<Job>& jobs) {
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        Job job;
+        job.frames = 0;
+        if (!(fields >> job.rom) || job.rom[0] == '#') {
+            continue;
+        }
+        if (!(fields >> job.movie)) {
+            job.movie = "-";
+        }
+        std::string frames;
+        if (fields >> frames) {
+            char* end;
+            job.frames = std::strtoull(frames.c_str(), &end, 10);
+            if (*end != '\0') {
+                std::cerr << "Bad frame count on line " << lineNumber << ": " << frames << std::endl;
+                return false;
+            }
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// the System loads whatever it's given, so anything it can't really run is caught here
+bool checkRom(const std::string& path, std::string& error) {
+    Rom::nes_header header;
+    if (!Rom::readHeader(path.c_str(), header)) {
+        error = "not an iNES ROM";
+        return false;
+    }
+    if (header.prg_size == 0) {
+        error = "no PRG ROM";
+        return false;
+    }
+    int mapper = Rom::getMapper(header);
+    if (mapper != 0) {
+        error = "unsupported mapper " + std::to_string(mapper);
+        return false;
+    }
+    if (!Rom::hasFullImage(path.c_str(), header)) {
+        error = "ROM is truncated";
+        return false;
+    }
+    return true;
+}
+
+JobResult runJob(const Job& job) {
+    JobResult result;
+    result.frames = 0;
+    result.instructions = 0;
+    result.seconds = 0;
+    result.status = "error";
+    result.testCode = 0;
+
+    if (!std::ifstream(job.rom).good()) {
+        result.error = "could not open ROM";
+        return result;
+    }
+    if (!checkRom(job.rom, result.error)) {
+        return result;
+    }
+
+    // anything thrown has to end up in this job's result, escaping the worker would take the
+    // whole pool down with it
+    System* system = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        Movie movie;
+        bool hasMovie = job.movie != "-";
+        if (hasMovie) {
+            if (!movie.load(job.movie.c_str())) {
+                result.error = "could not load movie";
+                return result;
+            }
+            if (movie.romHash != 0 && movie.romHash != Movie::hashRom(job.rom.c_str())) {
+                result.error = "movie was recorded with a different ROM";
+                return result;
+            }
+        }
+
+        uint64_t frames = job.frames;
+        if (frames == 0) {
+            frames = hasMovie ? movie.frames.size() : testMode ? 3600 : 600;
+        }
+
+        start = std::chrono::steady_clock::now();
+        system = new System(job.rom);
+        system->cpu->logging = false;
+        TestRom test;
+        TestRom::Status testStatus = TestRom::Status::WAITING;
+        while (result.frames < frames && !system->stop) {
+            if (hasMovie) {
+                movie.apply(system, result.frames);
+            }
+            result.hash.add(system->runFrame());
+            result.frames++;
+
+            if (testMode) {
+                testStatus = test.update(system);
+                if (testStatus == TestRom::Status::PASSED || testStatus == TestRom::Status::FAILED) {
+                    break;
+                }
+            }
+        }
+
+        if (system->stop) {
+            result.status = "stopped";
+        } else if (!testMode) {
+            result.status = "ok";
+        } else if (testStatus == TestRom::Status::PASSED) {
+            result.status = "passed";
+        } else if (testStatus == TestRom::Status::FAILED) {
+            result.status = "failed";
+        } else {
+            result.status = "timeout";
+        }
+        if (testMode) {
+            result.testCode = test.getResultCode();
+            result.testText = TestRom::readText(system);
+        }
+    } catch (const std::exception& e) {
+        result.status = "error";
+        result.error = e.what();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (system != nullptr) {
+        result.instructions = system->instructionCount;
+        delete system;
+    }
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return result;
+}
+
+// every .nes under directory in name order, so job numbers stay the same between runs
+void findRoms(const char* directory, std::vector<Job>& jobs) {
+    std::vector<std::string> roms;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".nes") {
+            roms.push_back(entry.path().string());
+        }
+    }
+    std::sort(roms.begin(), roms.end());
+
+    for (const std::string& rom : roms) {
+        jobs.push_back({ rom, "-", 0 });
+    }
+}
+
+std::string formatResult(size_t index, const Job& job, const JobResult& result) {
+    char hashes[96];
+    std::snprintf(hashes, sizeof(hashes), "\"video_hash\": \"%016llx\", \"audio_hash\": \"%016llx\"",
+                  static_cast<unsigned long long>(result.hash.video), static_cast<unsigned long long>(result.hash.audio));
+
+    std::ostringstream out;
+    out << "{\"job\": " << index
+        << ", \"rom\": \"" << escapeJson(job.rom) << "\""
+        << ", \"movie\": " << (job.movie == "-" ? "null" : "\"" + escapeJson(job.movie) + "\"")
+        << ", \"status\": \"" << result.status << "\""
+        << ", \"frames\": " << result.frames
+        << ", \"instructions\": " << result.instructions
+        << ", \"seconds\": " << result.seconds
+        << ", \"fps\": " << static_cast<uint64_t>(result.seconds > 0 ? result.frames / result.seconds : 0)
+        << ", " << hashes;
+    if (testMode) {
+        out << ", \"result\": " << static_cast<int>(result.testCode)
+            << ", \"text\": \"" << escapeJson(result.testText) << "\"";
+    }
+    if (!result.error.empty()) {
+        out << ", \"error\": \"" << escapeJson(result.error) << "\"";
+    }
+    out << "}";
+    return out.str();
+}
+
+// each worker has its own queue and takes from its back, an idle worker steals from the front of
+// someone else's so one slow ROM doesn't leave the rest of a worker's share waiting behind it
+class JobPool {
+public:
+    JobPool(const std::vector<Job>& jobs, size_t workers) : jobs(jobs), queues(workers) {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            queues[i % workers].jobs.push_back(i);
+        }
+    }
+
+    void run() {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < queues.size(); i++) {
+            threads.emplace_back(&JobPool::work, this, i);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t getFailed() const {
+        return failed;
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    const std::vector<Job>& jobs;
+    std::vector<Queue> queues;
+    std::mutex outputLock;
+    size_t failed = 0;
+
+    bool take(size_t worker, size_t& job) {
+        {
+            Queue& own = queues[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.jobs.empty()) {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue& victim = queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t worker) {
+        size_t job;
+        while (take(worker, job)) {
+            JobResult result = runJob(jobs[job]);
+            std::string line = formatResult(job, jobs[job], result);
+
+            std::lock_guard<std::mutex> guard(outputLock);
+            std::cout << line << std::endl;
+            if (std::strcmp(result.status, "ok") != 0 && std::strcmp(result.status, "passed") != 0) {
+                failed++;
+            }
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    const char* jobsPath = nullptr;
+    size_t threads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--test") == 0) {
+            testMode = true;
+        } else if ((argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) && jobsPath == nullptr) {
+            jobsPath = argv[i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (jobsPath == nullptr) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<Job> jobs;
+    std::error_code error;
+    if (std::strcmp(jobsPath, "-") == 0) {
+        if (!loadJobs(std::cin, jobs)) {
+            return 1;
+        }
+    } else if (std::filesystem::is_directory(jobsPath, error)) {
+        findRoms(jobsPath, jobs);
+    } else {
+        std::ifstream file(jobsPath);
+        if (!file.is_open()) {
+            std::cerr << "Could not open job list: " << jobsPath << std::endl;
+            return 1;
+        }
+        if (!loadJobs(file, jobs)) {
+            return 1;
+        }
+    }
+
+    if (threads == 0) {
+        threads = 1;
+    }
+    if (threads > jobs.size() && !jobs.empty()) {
+        threads = jobs.size();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    JobPool pool(jobs, threads);
+    pool.run();
+    auto end = std::chrono::steady_clock::now();
+
+    std::cerr << jobs.size() << " jobs on " << threads << " threads in "
+              << std::chrono::duration<double>(end - start).count() << "s, " << pool.getFailed() << " failed" << std::endl;
+    return pool.getFailed() > 0 ? 1 : 0;
+}
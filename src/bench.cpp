@@ -0,0 +1,138 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <System.hpp>
+#include <Json.hpp>
+
+void printUsage() {
+    std::cerr << "usage: bench [--frames N] <rom>..." << std::endl;
+    std::cerr << "  runs each ROM for N frames (default 1800) with the same scripted input and" << std::endl;
+    std::cerr << "  prints the timings as one JSON document on stdout" << std::endl;
+}
+
+// the same input for every ROM and every run: press start a second in so menus move on,
+// then sweep the d-pad and tap A and B the way someone playing would
+uint8_t scriptedInput(uint64_t frame) {
+    if (frame < 60) {
+        return 0;
+    }
+    if (frame < 70) {
+        return JOYPAD_START;
+    }
+
+    static const uint8_t directions[4] = { JOYPAD_RIGHT, JOYPAD_DOWN, JOYPAD_LEFT, JOYPAD_UP };
+    uint8_t buttons = directions[(frame / 45) % 4];
+    if (frame % 20 < 4) {
+        buttons |= JOYPAD_A;
+    }
+    if (frame % 90 < 3) {
+        buttons |= JOYPAD_B;
+    }
+    return buttons;
+}
+
+struct BenchResult {
+    uint64_t frames;
+    uint64_t instructions;
+    double seconds;
+    uint64_t minNanoseconds;
+    uint64_t medianNanoseconds;
+    uint64_t p99Nanoseconds;
+    std::string error;
+};
+
+BenchResult runBench(const char* romPath, uint64_t frames) {
+    BenchResult result = {};
+    std::vector<uint64_t> frameTimes;
+    frameTimes.reserve(frames);
+
+    System system(romPath);
+    system.cpu->logging = false;
+
+    try {
+        while (result.frames < frames && !system.stop) {
+            system.joypad->setState(scriptedInput(result.frames));
+
+            auto start = std::chrono::steady_clock::now();
+            system.runFrame();
+            auto end = std::chrono::steady_clock::now();
+
+            frameTimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            result.frames++;
+        }
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    if (system.stop && result.error.empty()) {
+        result.error = "CPU stopped";
+    }
+
+    result.instructions = system.instructionCount;
+    for (uint64_t time : frameTimes) {
+        result.seconds += time / 1e9;
+    }
+
+    if (!frameTimes.empty()) {
+        std::sort(frameTimes.begin(), frameTimes.end());
+        result.minNanoseconds = frameTimes.front();
+        result.medianNanoseconds = frameTimes[frameTimes.size() / 2];
+        result.p99Nanoseconds = frameTimes[std::min(frameTimes.size() - 1, frameTimes.size() * 99 / 100)];
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    uint64_t frames = 1800;
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-') {
+            roms.push_back(argv[i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (roms.empty() || frames == 0) {
+        printUsage();
+        return 1;
+    }
+
+    std::cout << "{\n  \"frames\": " << frames << ",\n  \"results\": [";
+    for (size_t i = 0; i < roms.size(); i++) {
+        std::cout << (i == 0 ? "\n" : ",\n");
+        std::cout << "    {\"rom\": \"" << escapeJson(roms[i]) << "\"";
+
+        if (!std::ifstream(roms[i]).good()) {
+            std::cout << ", \"error\": \"could not open ROM\"}";
+            continue;
+        }
+
+        BenchResult result = runBench(roms[i], frames);
+        double fps = result.seconds > 0 ? result.frames / result.seconds : 0;
+        double ips = result.seconds > 0 ? result.instructions / result.seconds : 0;
+        std::cout << ", \"frames\": " << result.frames
+                  << ", \"fps\": " << static_cast<uint64_t>(fps)
+                  << ", \"instructions_per_second\": " << static_cast<uint64_t>(ips)
+                  << ", \"ns_per_frame\": {\"min\": " << result.minNanoseconds
+                  << ", \"median\": " << result.medianNanoseconds
+                  << ", \"p99\": " << result.p99Nanoseconds << "}";
+        if (!result.error.empty()) {
+            std::cout << ", \"error\": \"" << escapeJson(result.error) << "\"";
+        }
+        std::cout << "}";
+        std::cout.flush();
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,400 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <System.hpp>
+#include <NsfPlayer.hpp>
+#include <WavWriter.hpp>
+#include <Movie.hpp>
+#include <FrameHash.hpp>
+#include <TestRom.hpp>
+#include <Trace.hpp>
+#include <Profiler.hpp>
+#include <Symbols.hpp>
+#include <Coverage.hpp>
+#include <Rom.hpp>
+
+// samples quieter than this count as silence for --until-silence
+#define SILENCE_THRESHOLD 64
+
+void printUsage() {
+    std::cerr << "usage: headless <rom.nes|tune.nsf> [options]" << std::endl;
+    std::cerr << "  --frames N         run at most N frames (default 600, or the movie's length)" << std::endl;
+    std::cerr << "  --wav FILE         write the APU output to FILE" << std::endl;
+    std::cerr << "  --until-silence N  stop once audio has been silent for N frames after making sound" << std::endl;
+    std::cerr << "  --song N           NSF song to play, 1 based (default: the file's starting song)" << std::endl;
+    std::cerr << "  --run-ahead N      emulate N frames ahead of every frame, to measure the cost" << std::endl;
+    std::cerr << "  --movie FILE       play back joypad input from the SDL frontend's --record or an FCEUX .fm2" << std::endl;
+    std::cerr << "  --hashes FILE      write a hash of every frame's picture and audio to FILE" << std::endl;
+    std::cerr << "  --check FILE       compare every frame against hashes written by --hashes, exit 1 on the first difference" << std::endl;
+    std::cerr << "  --trace-events FILE" << std::endl;
+    std::cerr << "                     write Chrome trace-event JSON of each frame's CPU, PPU and audio time to FILE" << std::endl;
+    std::cerr << "  --profile FILE     write the CPU cycles spent in every 6502 call path to FILE as collapsed stacks" << std::endl;
+    std::cerr << "                     for flamegraph.pl, inferno or speedscope" << std::endl;
+    std::cerr << "  --profile-frames FILE" << std::endl;
+    std::cerr << "                     the same with every frame under its own \"frame N\" root" << std::endl;
+    std::cerr << "  --symbols FILE     name profiled routines from a ca65 .dbg, ld65 -Ln or FCEUX .nl file, may be repeated" << std::endl;
+    std::cerr << "  --coverage FILE    write which PRG ROM and RAM bytes were executed, read and written to FILE, as an" << std::endl;
+    std::cerr << "                     FCEUX/Mesen code/data log if it ends in .cdl" << std::endl;
+    std::cerr << "  --test-rom         run a blargg style test ROM until it reports through $6000 (at most 3600 frames" << std::endl;
+    std::cerr << "                     unless --frames says otherwise), print its message and exit 0 only if it passed" << std::endl;
+}
+
+// --hashes writes a line of "frame video audio" per frame, with the hashes in hex
+bool loadHashes(const char* path, std::vector<FrameHash>& hashes) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open hashes: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        unsigned long long frame, video, audio;
+        if (std::sscanf(line.c_str(), "%llu %llx %llx", &frame, &video, &audio) != 3 || frame != hashes.size()) {
+            std::cerr << "Bad line in " << path << ": " << line << std::endl;
+            return false;
+        }
+        FrameHash hash;
+        hash.video = video;
+        hash.audio = audio;
+        hashes.push_back(hash);
+    }
+    // golden-update truncates the file first, so an empty one is a run that died partway
+    if (hashes.empty()) {
+        std::cerr << "No hashes in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool isNsf(const char* path) {
+    char magic[5] = {};
+    std::ifstream file(path, std::ios::binary);
+    file.read(magic, sizeof(magic));
+    return file.good() && std::memcmp(magic, "NESM\x1A", sizeof(magic)) == 0;
+}
+
+bool isSilent(const int16_t* samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] > SILENCE_THRESHOLD || samples[i] < -SILENCE_THRESHOLD) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* romPath = nullptr;
+    const char* wavPath = nullptr;
+    uint64_t maxFrames = 0;
+    uint64_t untilSilence = 0;
+    int song = 0;
+    int runAhead = 0;
+    const char* moviePath = nullptr;
+    const char* hashesPath = nullptr;
+    const char* checkPath = nullptr;
+    bool testRom = false;
+    const char* tracePath = nullptr;
+    const char* profilePath = nullptr;
+    const char* profileFramesPath = nullptr;
+    Symbols symbols;
+    const char* coveragePath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            maxFrames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+            wavPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--until-silence") == 0 && i + 1 < argc) {
+            untilSilence = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--song") == 0 && i + 1 < argc) {
+            song = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--movie") == 0 && i + 1 < argc) {
+            moviePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            runAhead = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hashes") == 0 && i + 1 < argc) {
+            hashesPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+            checkPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace-events") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile-frames") == 0 && i + 1 < argc) {
+            profileFramesPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+            if (!symbols.add(argv[++i])) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--coverage") == 0 && i + 1 < argc) {
+            coveragePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--test-rom") == 0) {
+            testRom = true;
+        } else if (argv[i][0] != '-' && romPath == nullptr) {
+            romPath = argv[i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (romPath == nullptr) {
+        printUsage();
+        return 1;
+    }
+    if (!std::ifstream(romPath).good()) {
+        std::cerr << "Could not open ROM: " << romPath << std::endl;
+        return 1;
+    }
+
+    Movie* movie = nullptr;
+    if (moviePath != nullptr) {
+        movie = new Movie();
+        if (!movie->load(moviePath)) {
+            delete movie;
+            return 1;
+        }
+        if (movie->romHash != 0 && movie->romHash != Movie::hashRom(romPath)) {
+            std::cerr << "Movie was recorded with a different ROM" << std::endl;
+            delete movie;
+            return 1;
+        }
+        if (maxFrames == 0) {
+            maxFrames = movie->frames.size();
+        }
+    }
+
+    std::vector<FrameHash> baseline;
+    if (checkPath != nullptr) {
+        if (!loadHashes(checkPath, baseline)) {
+            delete movie;
+            return 1;
+        }
+        if (maxFrames == 0 || maxFrames > baseline.size()) {
+            maxFrames = baseline.size();
+        }
+    }
+    if (maxFrames == 0) {
+        maxFrames = testRom ? 3600 : 600;
+    }
+
+    std::ofstream hashes;
+    if (hashesPath != nullptr) {
+        hashes.open(hashesPath, std::ios::out | std::ios::trunc);
+        if (!hashes.is_open()) {
+            std::cerr << "Could not write hashes: " << hashesPath << std::endl;
+            delete movie;
+            return 1;
+        }
+    }
+
+    System* system;
+    NsfPlayer* nsf = nullptr;
+    if (isNsf(romPath)) {
+        nsf = new NsfPlayer(romPath);
+        if (!nsf->isLoaded()) {
+            delete nsf;
+            return 1;
+        }
+        if (song > 0) {
+            nsf->selectSong(song);
+        }
+        std::cout << nsf->title << " - " << nsf->artist << " (song " << (song > 0 ? song : nsf->startingSong)
+                  << " of " << static_cast<int>(nsf->songCount) << ")" << std::endl;
+        system = nsf->system;
+    } else {
+        system = new System(romPath);
+        system->cpu->logging = false;
+    }
+
+    WavWriter* wav = nullptr;
+    if (wavPath != nullptr) {
+        wav = new WavWriter(wavPath, APU::SAMPLE_RATE);
+        if (!wav->isOpen()) {
+            std::cerr << "Could not open WAV file: " << wavPath << std::endl;
+            delete wav;
+            return 1;
+        }
+    }
+
+    Tracer* tracer = nullptr;
+    if (tracePath != nullptr) {
+        tracer = new Tracer();
+        Tracer::setActive(tracer);
+        tracer->nameThread("headless");
+    }
+
+    system->cpu->symbols = &symbols;
+
+    Profiler* profiler = nullptr;
+    if (profilePath != nullptr || profileFramesPath != nullptr) {
+        profiler = new Profiler(&symbols);
+        system->cpu->profiler = profiler;
+    }
+
+    Coverage* coverage = nullptr;
+    if (coveragePath != nullptr) {
+        // NSFs have no iNES header, their code is mapped straight into $8000-$FFFF
+        Rom::nes_header header;
+        bool ines = Rom::readHeader(romPath, header);
+        coverage = new Coverage(ines ? header.prg_size * 0x4000 : 0x8000, ines ? header.chr_size * 0x2000 : 0);
+        system->bus->coverage = coverage;
+    }
+
+    uint64_t frames = 0;
+    uint64_t samples = 0;
+    uint64_t silentFrames = 0;
+    bool heardSound = false;
+    bool mismatch = false;
+    TestRom test;
+    TestRom::Status testStatus = TestRom::Status::WAITING;
+
+    auto start = std::chrono::steady_clock::now();
+    while (frames < maxFrames && !system->stop) {
+        if (movie != nullptr) {
+            movie->apply(system, frames);
+        }
+        FrameView view = nsf != nullptr ? nsf->playFrame() : system->runFrameAhead(runAhead);
+        frames++;
+        samples += view.audioSamples;
+        if (profiler != nullptr) {
+            profiler->endFrame();
+        }
+
+        if (wav != nullptr) {
+            wav->write(view.audio, view.audioSamples);
+        }
+
+        if (hashesPath != nullptr || checkPath != nullptr) {
+            FrameHash hash;
+            hash.add(view);
+            if (hashesPath != nullptr) {
+                char line[64];
+                std::snprintf(line, sizeof(line), "%llu %016llx %016llx\n", static_cast<unsigned long long>(frames - 1),
+                              static_cast<unsigned long long>(hash.video), static_cast<unsigned long long>(hash.audio));
+                hashes << line;
+            }
+            if (checkPath != nullptr) {
+                if (frames > baseline.size()) {
+                    std::cerr << "Frame " << frames - 1 << " is past the end of " << checkPath << std::endl;
+                    mismatch = true;
+                    break;
+                }
+                const FrameHash& expected = baseline[frames - 1];
+                if (hash.video != expected.video || hash.audio != expected.audio) {
+                    std::cerr << "Frame " << frames - 1 << " differs from " << checkPath << ":"
+                              << (hash.video != expected.video ? " video" : "")
+                              << (hash.audio != expected.audio ? " audio" : "") << std::endl;
+                    mismatch = true;
+                    break;
+                }
+            }
+        }
+
+        if (testRom) {
+            testStatus = test.update(system);
+            if (testStatus == TestRom::Status::PASSED || testStatus == TestRom::Status::FAILED) {
+                break;
+            }
+        }
+
+        if (untilSilence > 0) {
+            if (isSilent(view.audio, view.audioSamples)) {
+                silentFrames++;
+            } else {
+                heardSound = true;
+                silentFrames = 0;
+            }
+            if (heardSound && silentFrames >= untilSilence) {
+                break;
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (checkPath != nullptr && !mismatch && frames < baseline.size()) {
+        std::cerr << "Stopped after " << frames << " frames, " << checkPath << " has " << baseline.size() << std::endl;
+        mismatch = true;
+    }
+    if (hashesPath != nullptr) {
+        hashes.close();
+    }
+
+    bool testFailed = false;
+    if (nsf != nullptr && nsf->skippedPlays > 0) {
+        std::cout << nsf->skippedPlays << " PLAY calls skipped while the previous one was still running" << std::endl;
+    }
+
+    if (testRom) {
+        std::string text = TestRom::readText(system);
+        if (!text.empty()) {
+            std::cout << text << (text.back() == '\n' ? "" : "\n");
+        }
+        if (testStatus == TestRom::Status::PASSED) {
+            std::cout << "Passed" << std::endl;
+        } else if (testStatus == TestRom::Status::FAILED) {
+            std::cout << "Failed with code " << static_cast<int>(test.getResultCode()) << std::endl;
+        } else if (testStatus == TestRom::Status::RUNNING) {
+            std::cout << "Timed out after " << frames << " frames" << std::endl;
+        } else {
+            std::cout << "Never reported a result, not a test ROM?" << std::endl;
+        }
+        testFailed = testStatus != TestRom::Status::PASSED;
+    }
+
+    if (tracer != nullptr) {
+        tracer->write(tracePath);
+        delete tracer;
+    }
+
+    if (profiler != nullptr) {
+        system->cpu->profiler = nullptr;
+        if (profilePath != nullptr) {
+            profiler->writeCollapsed(profilePath, false);
+        }
+        if (profileFramesPath != nullptr) {
+            profiler->writeCollapsed(profileFramesPath, true);
+        }
+        delete profiler;
+    }
+
+    if (coverage != nullptr) {
+        system->bus->coverage = nullptr;
+        coverage->write(coveragePath);
+        coverage->summary(std::cout);
+        delete coverage;
+    }
+
+    // only counted in make STATS=1 builds
+    if (Stats::ENABLED) {
+        system->stats.dump(std::cerr);
+    }
+
+    if (wav != nullptr) {
+        wav->close();
+        delete wav;
+    }
+
+    if (movie != nullptr) {
+        delete movie;
+    }
+    if (nsf != nullptr) {
+        delete nsf;
+    } else {
+        delete system;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double audioSeconds = static_cast<double>(samples) / APU::SAMPLE_RATE;
+    std::cout << frames << " frames, " << audioSeconds << "s of audio in " << seconds << "s ("
+              << (seconds > 0 ? audioSeconds / seconds : 0) << "x realtime)" << std::endl;
+
+    return mismatch || testFailed ? 1 : 0;
+}
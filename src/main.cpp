@@ -1,8 +1,22 @@
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
 
 #include <PPU.hpp>
 #include <System.hpp>
+#include <TripleBuffer.hpp>
+#include <SpscQueue.hpp>
+#include <Rewind.hpp>
+#include <Movie.hpp>
+#include <Trace.hpp>
+#include <Profiler.hpp>
+#include <Symbols.hpp>
+#include <Coverage.hpp>
+#include <Rom.hpp>
 
 #include <SDL2/SDL.h>
 
@@ -27,199 +41,249 @@ const std::vector<SDL_Color> nesPalette = {
  { 0x99, 0xFF, 0xFC, 0xff }, { 0xDD, 0xDD, 0xDD, 0xff }, { 0x11, 0x11, 0x11, 0xff }, { 0x11, 0x11, 0x11, 0xff },
 };
 
-std::vector<uint8_t> bgPalette(PPU* ppu, int tileColumn, int tileRow) {
-    int attributeTableIdx = tileRow / 4 * 8 + tileColumn / 4;
-    uint8_t attributeByte = ppu->vram[0x3C0 + attributeTableIdx];
-
-    uint8_t pallet_idx;
-    switch ((tileColumn % 4) / 2 * 2 + (tileRow % 4) / 2) {
-        case 0: pallet_idx = attributeByte & 0b11; break;
-        case 1: pallet_idx = (attributeByte >> 2) & 0b11; break;
-        case 2: pallet_idx = (attributeByte >> 4) & 0b11; break;
-        case 3: pallet_idx = (attributeByte >> 6) & 0b11; break;
-        default: throw std::runtime_error("should not happen");
+// nesPalette packed in SDL_PIXELFORMAT_RGBA32 byte order so a pixel is a single store
+std::array<uint32_t, 64> buildRgbaPalette() {
+    std::array<uint32_t, 64> rgba;
+    for (int i = 0; i < 64; i++) {
+        std::memcpy(&rgba[i], &nesPalette[i], sizeof(uint32_t));
     }
+    return rgba;
+}
+
+const std::array<uint32_t, 64> rgbaPalette = buildRgbaPalette();
 
-    return {
-        ppu->palette[0],
-        ppu->palette[pallet_idx * 4 + 1],
-        ppu->palette[pallet_idx * 4 + 2],
-        ppu->palette[pallet_idx * 4 + 3]
-    };
+void render(const uint8_t* pixels, uint8_t* dst, int pitch) {
+    for (int y = 0; y < PPU::SCREEN_HEIGHT; y++) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(dst + y * pitch);
+        const uint8_t* src = pixels + y * PPU::SCREEN_WIDTH;
+        for (int x = 0; x < PPU::SCREEN_WIDTH; x++) {
+            row[x] = rgbaPalette[src[x]];
+        }
+    }
 }
 
-std::vector<uint8_t> spritePalette(PPU* ppu, int spriteIdx) {
-    uint8_t start = 0x11 + spriteIdx * 4;
-    return {
-        0,
-        ppu->palette[start],
-        ppu->palette[start + 1],
-        ppu->palette[start + 2]
-    };
+// converts straight into the streaming texture's memory instead of staging an RGBA copy
+bool uploadFrame(SDL_Texture* texture, const uint8_t* pixels) {
+    TRACE_SCOPE("frame conversion");
+    void* texturePixels;
+    int pitch;
+    if (SDL_LockTexture(texture, nullptr, &texturePixels, &pitch) != 0) {
+        std::cerr << "SDL_LockTexture Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    render(pixels, static_cast<uint8_t*>(texturePixels), pitch);
+    SDL_UnlockTexture(texture);
+    return true;
 }
 
-uint8_t* showTile(PPU* ppu, int bank, int tileN, std::vector<uint8_t> palette) {
-    uint8_t* frame = new uint8_t[8 * 8 * 4];
-    // zero out the frame
-    for (int i = 0; i < 8 * 8 * 4; i++) {
-        frame[i] = 0;
+#define AUDIO_DEVICE_SAMPLES 512
+// dynamic rate control steers the ring buffer towards this fill level by nudging the
+// APU's output rate at most MAX_RATE_DELTA either way, which is far below audible pitch change
+#define AUDIO_TARGET_BUFFERED 1024
+#define MAX_RATE_DELTA 0.005
+// 29780.5 cpu cycles at 1.789773 MHz
+#define FRAME_NANOSECONDS 16639267
+// a few hundred bytes a frame, enough for tens of minutes of history
+#define REWIND_BYTES (32 * 1024 * 1024)
+
+typedef std::array<uint8_t, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT> FrameBuffer;
+
+typedef SpscQueue<int16_t, 8192> AudioRing;
+
+enum class InputKind {
+    JOYPAD,
+    REWIND,
+    RESET,
+    POWER
+};
+
+struct InputEvent {
+    InputKind kind;
+    uint8_t button;  // JOYPAD_* bit for InputKind::JOYPAD
+    bool pressed;
+};
+
+bool mapKey(SDL_Keycode key, InputEvent& event) {
+    event.kind = InputKind::JOYPAD;
+    event.button = 0;
+    switch (key) {
+        case SDLK_UP: event.button = JOYPAD_UP; return true;
+        case SDLK_DOWN: event.button = JOYPAD_DOWN; return true;
+        case SDLK_LEFT: event.button = JOYPAD_LEFT; return true;
+        case SDLK_RIGHT: event.button = JOYPAD_RIGHT; return true;
+        case SDLK_z: event.button = JOYPAD_A; return true;
+        case SDLK_x: event.button = JOYPAD_B; return true;
+        case SDLK_RETURN: event.button = JOYPAD_START; return true;
+        case SDLK_RSHIFT: event.button = JOYPAD_SELECT; return true;
+        case SDLK_BACKSPACE: event.kind = InputKind::REWIND; return true;
+        case SDLK_F1: event.kind = InputKind::RESET; return true;
+        case SDLK_F2: event.kind = InputKind::POWER; return true;
+        default: return false;
     }
-    int bankOffset = bank * 0x1000;
-    int tileStart = bankOffset + tileN * 16;
-    int tileEnd = tileStart + 16;
-    std::vector<uint8_t> tile(ppu->chrRom.begin() + tileStart, ppu->chrRom.begin() + tileEnd);
-    for (int y = 0; y < 8; y++) {
-        uint8_t upper = tile[y];
-        uint8_t lower = tile[y + 8];
-
-        for (int x = 7; x >= 0; x--) {
-            int value = (1 & lower) << 1 | (1 & upper);
-            upper >>= 1;
-            lower >>= 1;
-    
-            SDL_Color color;
-            switch (value) {
-                case 0: color = nesPalette[ppu->palette[0]]; break;
-                case 1: color = nesPalette[palette[1]]; break;
-                case 2: color = nesPalette[palette[2]]; break;
-                case 3: color = nesPalette[palette[3]]; break;
-            }
+}
 
-            frame[(y * 8 + x) * 4] = color.r;
-            frame[(y * 8 + x) * 4 + 1] = color.g;
-            frame[(y * 8 + x) * 4 + 2] = color.b;
-            frame[(y * 8 + x) * 4 + 3] = color.a;
-        }
+// how the emulation thread drives the machine, fixed for the whole run
+struct EmulationSettings {
+    int runAhead;
+    // appended to every frame, or null
+    Movie* record;
+    // replaces live input until it runs out, or null
+    const Movie* playback;
+};
+
+void audioCallback(void* userdata, Uint8* stream, int len) {
+    AudioRing* audio = static_cast<AudioRing*>(userdata);
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    size_t count = len / sizeof(int16_t);
+
+    // on an underrun hold the last level instead of clicking to zero
+    size_t popped = audio->pop(out, count);
+    int16_t last = popped > 0 ? out[popped - 1] : 0;
+    for (size_t i = popped; i < count; i++) {
+        out[i] = last;
     }
+}
 
-    return frame;
+double rateAdjust(size_t buffered) {
+    double error = (static_cast<double>(AUDIO_TARGET_BUFFERED) - buffered) / AUDIO_TARGET_BUFFERED;
+    if (error > 1.0) {
+        error = 1.0;
+    } else if (error < -1.0) {
+        error = -1.0;
+    }
+    return 1.0 + MAX_RATE_DELTA * error;
 }
 
-uint8_t* showSprite(PPU* ppu, int bank, int tileN, std::vector<uint8_t> palette, bool flipVertical, bool flipHorizontal) {
-    uint8_t* frame = new uint8_t[8 * 8 * 4];
-    // zero out the frame
-    for (int i = 0; i < 8 * 8 * 4; i++) {
-        frame[i] = 0;
+// owns the System for its whole lifetime, the SDL thread only ever sees finished frames
+void emulationThread(System* system, TripleBuffer<FrameBuffer>* frames, SpscQueue<InputEvent, 64>* input, AudioRing* audio, const EmulationSettings* settings, std::atomic<bool>* running) {
+    auto nextFrame = std::chrono::steady_clock::now();
+    RewindBuffer rewind(REWIND_BYTES);
+    bool rewinding = false;
+    size_t movieFrame = 0;
+    if (Tracer::getActive() != nullptr) {
+        Tracer::getActive()->nameThread("emulation");
     }
-    int bankOffset = bank;
-    int tileStart = bankOffset + tileN * 16;
-    int tileEnd = tileStart + 16;
-    std::vector<uint8_t> tile(ppu->chrRom.begin() + tileStart, ppu->chrRom.begin() + tileEnd);
-    for (int y = 0; y < 8; y++) {
-        uint8_t upper = tile[y];
-        uint8_t lower = tile[y + 8];
-
-        for (int x = 7; x >= 0; x--) {
-            int value = (1 & lower) << 1 | (1 & upper);
-            upper >>= 1;
-            lower >>= 1;
-    
-            SDL_Color color;
-            switch (value) {
-                case 0: continue;
-                case 1: color = nesPalette[palette[1]]; break;
-                case 2: color = nesPalette[palette[2]]; break;
-                case 3: color = nesPalette[palette[3]]; break;
+
+    while (running->load(std::memory_order_relaxed) && !system->stop) {
+        uint8_t commands = 0;
+        InputEvent event;
+        while (input->pop(event)) {
+            switch (event.kind) {
+                case InputKind::JOYPAD: system->joypad->setButtonState(event.button, event.pressed); break;
+                case InputKind::REWIND: rewinding = event.pressed; break;
+                case InputKind::RESET: commands |= event.pressed ? MOVIE_RESET : 0; break;
+                case InputKind::POWER: commands |= event.pressed ? MOVIE_POWER : 0; break;
             }
+        }
 
-            if (flipHorizontal) {
-                if (flipVertical) {
-                    frame[((7 - y) * 8 + (7 - x)) * 4] = color.r;
-                    frame[((7 - y) * 8 + (7 - x)) * 4 + 1] = color.g;
-                    frame[((7 - y) * 8 + (7 - x)) * 4 + 2] = color.b;
-                    frame[((7 - y) * 8 + (7 - x)) * 4 + 3] = color.a;
-                } else {
-                    frame[(y * 8 + (7 - x)) * 4] = color.r;
-                    frame[(y * 8 + (7 - x)) * 4 + 1] = color.g;
-                    frame[(y * 8 + (7 - x)) * 4 + 2] = color.b;
-                    frame[(y * 8 + (7 - x)) * 4 + 3] = color.a;
+        // while rewinding, step back a frame and replay the one before it for its picture, so
+        // letting go of the key carries on from exactly where the history and the movie end.
+        // at the start of the history the picture just holds
+        bool advance = true;
+        if (rewinding) {
+            TRACE_SCOPE("rewind");
+            advance = rewind.stepBack(system, settings->record, settings->playback, movieFrame);
+        } else {
+            {
+                TRACE_SCOPE("rewind");
+                rewind.push(system);
+            }
+            // counts every frame, so it stays in step with the history after a movie runs out
+            bool played = settings->playback != nullptr && settings->playback->apply(system, movieFrame);
+            movieFrame++;
+            if (!played) {
+                if (commands & MOVIE_POWER) {
+                    system->power();
                 }
-            } else {
-                if (flipVertical) {
-                    frame[((7 - y) * 8 + x) * 4] = color.r;
-                    frame[((7 - y) * 8 + x) * 4 + 1] = color.g;
-                    frame[((7 - y) * 8 + x) * 4 + 2] = color.b;
-                    frame[((7 - y) * 8 + x) * 4 + 3] = color.a;
-                } else {
-                    frame[(y * 8 + x) * 4] = color.r;
-                    frame[(y * 8 + x) * 4 + 1] = color.g;
-                    frame[(y * 8 + x) * 4 + 2] = color.b;
-                    frame[(y * 8 + x) * 4 + 3] = color.a;
+                if (commands & MOVIE_RESET) {
+                    system->reset();
+                }
+                if (settings->record != nullptr) {
+                    settings->record->record(system, commands);
                 }
             }
         }
-    }
 
-    return frame;
-}
+        if (advance) {
+            TRACE_SCOPE("frame");
+            FrameView view = rewinding ? system->runFrame() : system->runFrameAhead(settings->runAhead);
+            std::memcpy(frames->writeBuffer().data(), view.pixels, PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT);
+            frames->publish();
 
-uint8_t* render(PPU* ppu) {
-    uint8_t* frame = new uint8_t[256 * 240 * 4];
+            if (audio != nullptr && !rewinding) {
+                audio->push(view.audio, view.audioSamples);
+                system->apu->setSampleRateAdjust(rateAdjust(audio->size()));
+            }
+        }
 
-    // zero out the frame
-    for (int i = 0; i < 256 * 240 * 4; i++) {
-        frame[i] = 0;
+        // pace to NTSC, but don't try to catch up after a long stall
+        auto now = std::chrono::steady_clock::now();
+        nextFrame += std::chrono::nanoseconds(FRAME_NANOSECONDS);
+        if (nextFrame < now - std::chrono::nanoseconds(FRAME_NANOSECONDS)) {
+            nextFrame = now;
+        }
+        std::this_thread::sleep_until(nextFrame);
     }
 
-    for (int i = 0; i < 0x03c0; i++) {
-        uint8_t tile = ppu->vram[i];
-        int tileX = i % 32;
-        int tileY = i / 32;
-        std::vector<uint8_t> palette = bgPalette(ppu, tileX, tileY);
-
-        uint8_t* tileFrame = showTile(ppu, 0, tile, palette);
+    running->store(false, std::memory_order_relaxed);
+}
 
-        for (int j = 0; j < 8; j++) {
-            for (int k = 0; k < 8; k++) {
-                frame[((tileY * 8 + j) * 256 + tileX * 8 + k) * 4] = tileFrame[(j * 8 + k) * 4];
-                frame[((tileY * 8 + j) * 256 + tileX * 8 + k) * 4 + 1] = tileFrame[(j * 8 + k) * 4 + 1];
-                frame[((tileY * 8 + j) * 256 + tileX * 8 + k) * 4 + 2] = tileFrame[(j * 8 + k) * 4 + 2];
-                frame[((tileY * 8 + j) * 256 + tileX * 8 + k) * 4 + 3] = tileFrame[(j * 8 + k) * 4 + 3];
+int main(int argc, char** argv) {
+    const char* romPath = "pacman.nes";
+    bool trace = false;
+    int runAhead = 0;
+    const char* recordPath = nullptr;
+    const char* playPath = nullptr;
+    const char* tracePath = nullptr;
+    const char* profilePath = nullptr;
+    Symbols symbols;
+    const char* coveragePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--trace") == 0) {
+            trace = true;
+        } else if (std::strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            // frames of input lag to hide, each one costs a full extra frame of emulation
+            runAhead = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--play") == 0 && i + 1 < argc) {
+            playPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace-events") == 0 && i + 1 < argc) {
+            // Chrome trace-event JSON of where each frame's time goes, written on exit and on F3
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            // collapsed stacks of the CPU cycles in every 6502 call path, written on exit
+            profilePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--coverage") == 0 && i + 1 < argc) {
+            // which bytes ran, were read and written, a code/data log if it ends in .cdl. written on exit
+            coveragePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+            // ca65 .dbg, ld65 -Ln or FCEUX .nl names for --trace and --profile, may be repeated
+            if (!symbols.add(argv[++i])) {
+                return 1;
             }
+        } else {
+            romPath = argv[i];
         }
-
-        delete[] tileFrame;
     }
 
-    // draw sprites
-    // draw sprites
-    for (int i = 63; i >= 0; i--) {
-        int spriteIdx = i * 4;
-        uint16_t tileIdx = ppu->oam[spriteIdx + 1];
-        int tileX = ppu->oam[spriteIdx + 3];
-        int tileY = ppu->oam[spriteIdx];
-
-        bool flipVertical = ppu->oam[spriteIdx + 2] & 0x80;
-        bool flipHorizontal = ppu->oam[spriteIdx + 2] & 0x40;
-        int paletteIdx = ppu->oam[spriteIdx + 2] & 0x3;
-        std::vector<uint8_t> palette = spritePalette(ppu, paletteIdx);
-
-        int bank = ppu->controlRegister->sprt_pattern_addr();
-        uint8_t* tileFrame = showSprite(ppu, bank, tileIdx, palette, flipVertical, flipHorizontal);
-
-        for (int j = 0; j < 8; j++) {
-            for (int k = 0; k < 8; k++) {
-                int px = tileX + k;
-                int py = tileY + j;
-                if (px >= 0 && px < 256 && py >= 0 && py < 240) {
-                    if (tileFrame[(j * 8 + k) * 4] != 0 || tileFrame[(j * 8 + k) * 4 + 1] != 0 || tileFrame[(j * 8 + k) * 4 + 2] != 0) {
-                        frame[(py * 256 + px) * 4] = tileFrame[(j * 8 + k) * 4];
-                        frame[(py * 256 + px) * 4 + 1] = tileFrame[(j * 8 + k) * 4 + 1];
-                        frame[(py * 256 + px) * 4 + 2] = tileFrame[(j * 8 + k) * 4 + 2];
-                        frame[(py * 256 + px) * 4 + 3] = tileFrame[(j * 8 + k) * 4 + 3];
-                    }
-                }
-            }
+    Movie movie;
+    EmulationSettings settings = { runAhead, nullptr, nullptr };
+    if (playPath != nullptr) {
+        if (!movie.load(playPath)) {
+            return 1;
         }
-
-        delete[] tileFrame;
+        if (movie.romHash != 0 && movie.romHash != Movie::hashRom(romPath)) {
+            std::cerr << "Movie was recorded with a different ROM" << std::endl;
+            return 1;
+        }
+        settings.playback = &movie;
+    } else if (recordPath != nullptr) {
+        movie.romHash = Movie::hashRom(romPath);
+        settings.record = &movie;
     }
-    return frame;
-}
-
-#define SAMPLE_RATE 44100
 
-int main() {
     // init sdl
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
         std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
@@ -255,96 +319,124 @@ int main() {
 
     SDL_RenderSetScale(renderer, 3, 3);
 
-    System system("pacman.nes");
+    AudioRing audioRing;
+    SDL_AudioSpec audioSpec = {};
+    audioSpec.freq = APU::SAMPLE_RATE;
+    audioSpec.format = AUDIO_S16SYS;
+    audioSpec.channels = 1;
+    audioSpec.samples = AUDIO_DEVICE_SAMPLES;
+    audioSpec.callback = audioCallback;
+    audioSpec.userdata = &audioRing;
+
+    SDL_AudioDeviceID audioDevice = SDL_OpenAudioDevice(nullptr, 0, &audioSpec, nullptr, 0);
+    if (audioDevice == 0) {
+        std::cerr << "SDL_OpenAudioDevice Error: " << SDL_GetError() << std::endl;
+    } else {
+        SDL_PauseAudioDevice(audioDevice, 0);
+    }
+
+    Tracer* tracer = nullptr;
+    if (tracePath != nullptr) {
+        tracer = new Tracer();
+        Tracer::setActive(tracer);
+        tracer->nameThread("main");
+    }
+
+    System system(romPath);
+    system.cpu->logging = trace;
+    system.cpu->symbols = &symbols;
+
+    Profiler* profiler = nullptr;
+    if (profilePath != nullptr) {
+        profiler = new Profiler(&symbols);
+        system.cpu->profiler = profiler;
+    }
+
+    Coverage* coverage = nullptr;
+    Rom::nes_header header;
+    if (coveragePath != nullptr && Rom::readHeader(romPath, header)) {
+        coverage = new Coverage(header.prg_size * 0x4000, header.chr_size * 0x2000);
+        system.bus->coverage = coverage;
+    }
 
-    bool running = true;
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 
-    uint8_t* frame = render(system.ppu);
-    SDL_UpdateTexture(texture, nullptr, frame, 256 * 4);
+    uploadFrame(texture, system.ppu->frameBuffer);
 
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
-    while (running) {
+
+    TripleBuffer<FrameBuffer> frames;
+    SpscQueue<InputEvent, 64> input;
+    std::atomic<bool> running(true);
+    std::thread emulation(emulationThread, &system, &frames, &input, audioDevice != 0 ? &audioRing : nullptr, &settings, &running);
+
+    while (running.load(std::memory_order_relaxed)) {
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
-                running = false;
+                running.store(false, std::memory_order_relaxed);
             }
 
-            if (event.type == SDL_KEYDOWN) {
-                switch (event.key.keysym.sym) {
-                    case SDLK_UP:
-                        system.joypad->setButtonState(JOYPAD_UP, true);
-                        break;
-                    case SDLK_DOWN:
-                        system.joypad->setButtonState(JOYPAD_DOWN, true);
-                        break;
-                    case SDLK_LEFT:
-                        system.joypad->setButtonState(JOYPAD_LEFT, true);
-                        break;
-                    case SDLK_RIGHT:
-                        system.joypad->setButtonState(JOYPAD_RIGHT, true);
-                        break;
-                    case SDLK_z:
-                        system.joypad->setButtonState(JOYPAD_A, true);
-                        break;
-                    case SDLK_x:
-                        system.joypad->setButtonState(JOYPAD_B, true);
-                        break;
-                    case SDLK_RETURN:
-                        system.joypad->setButtonState(JOYPAD_START, true);
-                        break;
-                    case SDLK_RSHIFT:
-                        system.joypad->setButtonState(JOYPAD_SELECT, true);
-                        break;
-                }
+            InputEvent keyInput;
+            if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0 && mapKey(event.key.keysym.sym, keyInput)) {
+                keyInput.pressed = event.type == SDL_KEYDOWN;
+                input.push(keyInput);
             }
-            if (event.type == SDL_KEYUP) {
-                switch (event.key.keysym.sym) {
-                    case SDLK_UP:
-                        system.joypad->setButtonState(JOYPAD_UP, false);
-                        break;
-                    case SDLK_DOWN:
-                        system.joypad->setButtonState(JOYPAD_DOWN, false);
-                        break;
-                    case SDLK_LEFT:
-                        system.joypad->setButtonState(JOYPAD_LEFT, false);
-                        break;
-                    case SDLK_RIGHT:
-                        system.joypad->setButtonState(JOYPAD_RIGHT, false);
-                        break;
-                    case SDLK_z:
-                        system.joypad->setButtonState(JOYPAD_A, false);
-                        break;
-                    case SDLK_x:
-                        system.joypad->setButtonState(JOYPAD_B, false);
-                        break;
-                    case SDLK_RETURN:
-                        system.joypad->setButtonState(JOYPAD_START, false);
-                        break;
-                    case SDLK_RSHIFT:
-                        system.joypad->setButtonState(JOYPAD_SELECT, false);
-                        break;
-                }
+            if (event.type == SDL_KEYDOWN && event.key.repeat == 0 && event.key.keysym.sym == SDLK_F3 && tracer != nullptr && tracer->write(tracePath)) {
+                std::cout << "Wrote trace events to " << tracePath << std::endl;
             }
         }
 
-        system.step();
+        if (frames.update()) {
+            uploadFrame(texture, frames.readBuffer().data());
+        }
+
+        // blocks until the next refresh with vsync on, so events are polled once per refresh
+        TRACE_SCOPE("present");
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        SDL_RenderPresent(renderer);
+    }
 
-        if (System::instance->needsDraw()) {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
+    emulation.join();
 
-            uint8_t* frame = render(system.ppu);
-            SDL_UpdateTexture(texture, nullptr, frame, 256 * 4);
+    if (tracer != nullptr) {
+        tracer->write(tracePath);
+        delete tracer;
+    }
 
-            SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-            SDL_RenderPresent(renderer);
+    if (profiler != nullptr) {
+        system.cpu->profiler = nullptr;
+        if (profiler->writeCollapsed(profilePath, false)) {
+            std::cout << "Wrote profile to " << profilePath << std::endl;
         }
+        delete profiler;
     }
 
+    if (coverage != nullptr) {
+        system.bus->coverage = nullptr;
+        if (coverage->write(coveragePath)) {
+            std::cout << "Wrote coverage to " << coveragePath << std::endl;
+        }
+        coverage->summary(std::cout);
+        delete coverage;
+    }
+
+    // only counted in make STATS=1 builds
+    if (Stats::ENABLED) {
+        system.stats.dump(std::cerr);
+    }
+
+    if (recordPath != nullptr && movie.save(recordPath)) {
+        std::cout << "Recorded " << movie.frames.size() << " frames to " << recordPath << std::endl;
+    }
+
+    if (audioDevice != 0) {
+        SDL_CloseAudioDevice(audioDevice);
+    }
     SDL_CloseAudio();
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
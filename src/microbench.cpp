@@ -0,0 +1,311 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include <System.hpp>
+
+// every benchmark folds what it reads into this so the compiler can't drop the work
+static volatile uint32_t sink;
+
+void printUsage() {
+    std::cerr << "usage: microbench [options]" << std::endl;
+    std::cerr << "  --filter TEXT   only run benchmarks whose name contains TEXT" << std::endl;
+    std::cerr << "  --ops N         operations per timed run (default 1000000)" << std::endl;
+    std::cerr << "  --warmup N      untimed runs before measuring (default 2)" << std::endl;
+    std::cerr << "  --repeat N      timed runs, min and median are reported (default 9)" << std::endl;
+}
+
+// setup runs once on a fresh machine, then run is called for every warm-up and timed pass
+struct Bench {
+    const char* name;
+    void (*setup)(System* system);
+    // performs ops operations and returns how many it actually did
+    uint64_t (*run)(System* system, uint64_t ops);
+};
+
+void setupNothing(System* system) {
+}
+
+uint64_t busReadRam(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        sum += system->bus->read(i & 0x1FFF);
+    }
+    sink = sum;
+    return ops;
+}
+
+uint64_t busReadPrg(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        sum += system->bus->read(0x8000 | (i & 0x7FFF));
+    }
+    sink = sum;
+    return ops;
+}
+
+uint64_t busReadPpuStatus(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        sum += system->bus->read(0x2002 | ((i & 0x3FF) << 3));
+    }
+    sink = sum;
+    return ops;
+}
+
+uint64_t busReadApuStatus(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        sum += system->bus->read(0x4015);
+    }
+    sink = sum;
+    return ops;
+}
+
+uint64_t busReadJoypad(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        sum += system->bus->read(0x4016);
+    }
+    sink = sum;
+    return ops;
+}
+
+uint64_t busWriteRam(System* system, uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+        system->bus->write(i & 0x1FFF, i);
+    }
+    return ops;
+}
+
+uint64_t busWritePpuAddr(System* system, uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+        system->bus->write(0x2006, 0x20 | (i & 0x0F));
+    }
+    return ops;
+}
+
+uint64_t busWriteApu(System* system, uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+        system->bus->write(0x4000 | (i & 0x03), i);
+    }
+    return ops;
+}
+
+uint64_t mirrorVram(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        sum += system->ppu->mirrorVramAddress(0x2000 | (i & 0x0FFF));
+    }
+    sink = sum;
+    return ops;
+}
+
+void setupDataRegister(System* system) {
+    system->ppu->writeToControlRegister(0x00);
+    system->ppu->writeToAddrRegister(0x20);
+    system->ppu->writeToAddrRegister(0x00);
+}
+
+// the address auto-increments, so rewind it to the nametables every 1k accesses
+uint64_t writeDataRegister(System* system, uint64_t ops) {
+    for (uint64_t i = 0; i < ops; i++) {
+        if ((i & 0x3FF) == 0) {
+            setupDataRegister(system);
+        }
+        system->ppu->writeToDataRegister(i);
+    }
+    return ops;
+}
+
+uint64_t readDataRegister(System* system, uint64_t ops) {
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        if ((i & 0x3FF) == 0) {
+            setupDataRegister(system);
+        }
+        sum += system->ppu->readFromDataRegister();
+    }
+    sink = sum;
+    return ops;
+}
+
+// a full nametable of distinct tiles, every attribute quadrant used and a full OAM
+void setupRendering(System* system) {
+    PPU* ppu = system->ppu;
+    for (int i = 0; i < 0x2000; i++) {
+        ppu->chrRom[i] = static_cast<uint8_t>(i * 13);
+    }
+    for (int i = 0; i < 0x1000; i++) {
+        ppu->vram[i] = static_cast<uint8_t>(i);
+    }
+    for (int i = 0; i < 0x100; i++) {
+        ppu->oam[i] = static_cast<uint8_t>(i * 7);
+    }
+    ppu->writeToMaskRegister(0x1E);
+}
+
+// one op is one 8x8 tile of the 32x30 screen, sprites included
+uint64_t renderTiles(System* system, uint64_t ops) {
+    uint64_t frames = (ops + 959) / 960;
+    for (uint64_t i = 0; i < frames; i++) {
+        system->ppu->renderFrame();
+    }
+    sink = system->ppu->frameBuffer[frames % (PPU::SCREEN_WIDTH * PPU::SCREEN_HEIGHT)];
+    return frames * 960;
+}
+
+// fills PRG with back to back copies of an instruction and a JMP back to $8000 at the end, the
+// CPU then runs it without the PPU or APU being clocked
+void loadProgram(System* system, const uint8_t* instruction, size_t length) {
+    uint16_t address = 0x8000;
+    while (address + length + 3 < 0xFFF0) {
+        for (size_t i = 0; i < length; i++) {
+            system->bus->write(address++, instruction[i]);
+        }
+    }
+    system->bus->write(address++, 0x4C);
+    system->bus->writeWord(address, 0x8000);
+    system->bus->writeWord(0xFFFC, 0x8000);
+    system->cpu->powerOn();
+    system->cpu->logging = false;
+}
+
+uint64_t runCpu(System* system, uint64_t ops) {
+    CPU* cpu = system->cpu;
+    for (uint64_t i = 0; i < ops; i++) {
+        cpu->execOnce();
+    }
+    return ops;
+}
+
+// LDA #$42; STA $10
+void setupLoadStore(System* system) {
+    const uint8_t code[] = { 0xA9, 0x42, 0x85, 0x10 };
+    loadProgram(system, code, sizeof(code));
+}
+
+// ADC #$01; AND #$7F; EOR $10
+void setupAlu(System* system) {
+    const uint8_t code[] = { 0x69, 0x01, 0x29, 0x7F, 0x45, 0x10 };
+    loadProgram(system, code, sizeof(code));
+}
+
+// INC $10; ASL $11; ROR $12
+void setupReadModifyWrite(System* system) {
+    const uint8_t code[] = { 0xE6, 0x10, 0x06, 0x11, 0x66, 0x12 };
+    loadProgram(system, code, sizeof(code));
+}
+
+// CLC; BCC +0, a taken branch to the next instruction
+void setupBranch(System* system) {
+    const uint8_t code[] = { 0x18, 0x90, 0x00 };
+    loadProgram(system, code, sizeof(code));
+}
+
+// PHA; PLA
+void setupStack(System* system) {
+    const uint8_t code[] = { 0x48, 0x68 };
+    loadProgram(system, code, sizeof(code));
+}
+
+// LDA ($10),Y and STA $0300,X
+void setupIndexed(System* system) {
+    const uint8_t code[] = { 0xB1, 0x10, 0x9D, 0x00, 0x03 };
+    loadProgram(system, code, sizeof(code));
+    system->bus->writeWord(0x0010, 0x0400);
+}
+
+// JSR to a lone RTS at $FF00, two instructions per call
+void setupJump(System* system) {
+    const uint8_t code[] = { 0x20, 0x00, 0xFF };
+    loadProgram(system, code, sizeof(code));
+    system->bus->write(0xFF00, 0x60);
+}
+
+const Bench benches[] = {
+    { "bus.read.ram", setupNothing, busReadRam },
+    { "bus.read.prg", setupNothing, busReadPrg },
+    { "bus.read.ppu_status", setupNothing, busReadPpuStatus },
+    { "bus.read.apu_status", setupNothing, busReadApuStatus },
+    { "bus.read.joypad", setupNothing, busReadJoypad },
+    { "bus.write.ram", setupNothing, busWriteRam },
+    { "bus.write.ppu_addr", setupNothing, busWritePpuAddr },
+    { "bus.write.apu", setupNothing, busWriteApu },
+    { "cpu.load_store", setupLoadStore, runCpu },
+    { "cpu.alu", setupAlu, runCpu },
+    { "cpu.read_modify_write", setupReadModifyWrite, runCpu },
+    { "cpu.branch", setupBranch, runCpu },
+    { "cpu.stack", setupStack, runCpu },
+    { "cpu.indexed", setupIndexed, runCpu },
+    { "cpu.jsr_rts", setupJump, runCpu },
+    { "ppu.mirror_vram_address", setupNothing, mirrorVram },
+    { "ppu.write_data_register", setupDataRegister, writeDataRegister },
+    { "ppu.read_data_register", setupDataRegister, readDataRegister },
+    { "ppu.render_tile", setupRendering, renderTiles },
+};
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    uint64_t ops = 1000000;
+    int warmup = 2;
+    int repeat = 9;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (ops == 0 || repeat <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    std::cout << "{\n  \"ops\": " << ops << ", \"warmup\": " << warmup << ", \"repeat\": " << repeat << ",\n  \"results\": [";
+    bool first = true;
+    for (const Bench& bench : benches) {
+        if (filter != nullptr && std::strstr(bench.name, filter) == nullptr) {
+            continue;
+        }
+
+        // a fresh machine per benchmark so one can't leave state behind for the next
+        System system;
+        system.cpu->logging = false;
+        bench.setup(&system);
+
+        for (int i = 0; i < warmup; i++) {
+            bench.run(&system, ops);
+        }
+
+        std::vector<double> times;
+        for (int i = 0; i < repeat; i++) {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t done = bench.run(&system, ops);
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / done);
+        }
+        std::sort(times.begin(), times.end());
+
+        std::cout << (first ? "\n" : ",\n");
+        std::cout << "    {\"name\": \"" << bench.name << "\", \"ns_per_op\": {\"min\": " << times.front()
+                  << ", \"median\": " << times[times.size() / 2] << "}}";
+        std::cout.flush();
+        first = false;
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    return 0;
+}
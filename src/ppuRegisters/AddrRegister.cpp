@@ -1,4 +1,5 @@
 #include <ppuRegisters/AddrRegister.hpp>
+#include <SaveState.hpp>
 
 AddrRegister::AddrRegister() : value{0, 0}, hi_ptr(true) {}
 
@@ -38,4 +39,16 @@ void AddrRegister::reset_latch() {
 
 uint16_t AddrRegister::get() const {
     return (static_cast<uint16_t>(value[0]) << 8) | value[1];
+}
+
+void AddrRegister::saveState(StateWriter& state) const {
+    state.write(value[0]);
+    state.write(value[1]);
+    state.write(hi_ptr);
+}
+
+void AddrRegister::loadState(StateReader& state) {
+    state.read(value[0]);
+    state.read(value[1]);
+    state.read(hi_ptr);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <ppuRegisters/ControlRegister.hpp>
+#include <SaveState.hpp>
 
 #include <stdexcept>
 
@@ -45,3 +46,11 @@ bool ControlRegister::generate_vblank_nmi() const {
 void ControlRegister::update(uint8_t data) {
     bits = data;
 }
+
+void ControlRegister::saveState(StateWriter& state) const {
+    state.write(bits);
+}
+
+void ControlRegister::loadState(StateReader& state) {
+    state.read(bits);
+}
\ No newline at end of file
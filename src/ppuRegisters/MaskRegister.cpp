@@ -1,4 +1,5 @@
 #include <ppuRegisters/MaskRegister.hpp>
+#include <SaveState.hpp>
 
 MaskRegister::MaskRegister() : bits(0b00000000) {}
 
@@ -40,4 +41,12 @@ bool MaskRegister::emphasise_blue() const {
 
 void MaskRegister::update(uint8_t data) {
     bits = data;
+}
+
+void MaskRegister::saveState(StateWriter& state) const {
+    state.write(bits);
+}
+
+void MaskRegister::loadState(StateReader& state) {
+    state.read(bits);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <ppuRegisters/ScrollRegister.hpp>
+#include <SaveState.hpp>
 
 ScrollRegister::ScrollRegister() : scroll_x(0), scroll_y(0), latch(false) {}
 
@@ -13,4 +14,16 @@ void ScrollRegister::write(uint8_t data) {
 
 void ScrollRegister::reset_latch() {
     latch = false;
+}
+
+void ScrollRegister::saveState(StateWriter& state) const {
+    state.write(scroll_x);
+    state.write(scroll_y);
+    state.write(latch);
+}
+
+void ScrollRegister::loadState(StateReader& state) {
+    state.read(scroll_x);
+    state.read(scroll_y);
+    state.read(latch);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <ppuRegisters/StatusRegister.hpp>
+#include <SaveState.hpp>
 
 // Constructor
 StatusRegister::StatusRegister() : bits(0b00000000) {}
@@ -41,4 +42,12 @@ bool StatusRegister::is_in_vblank() const {
 
 uint8_t StatusRegister::snapshot() const {
     return bits;
+}
+
+void StatusRegister::saveState(StateWriter& state) const {
+    state.write(bits);
+}
+
+void StatusRegister::loadState(StateReader& state) {
+    state.read(bits);
 }
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include <iostream>
+#include <cstring>
 #include <PPU.hpp>
+#include <APU.hpp>
+#include <System.hpp>
+#include <Rewind.hpp>
+#include <Movie.hpp>
+#include <Lz.hpp>
 
 #define GREEN "\x1b[32m"
 #define RED "\x1b[31m"
@@ -210,7 +216,234 @@ void runPPUTests() {
     delete ppu;
 }
 
+void runAPUTests() {
+    APU* apu = new APU();
+    apu->writeStatus(0x01);
+    apu->writeRegister(0x4000, 0xBF);
+    apu->writeRegister(0x4002, 0xFD);
+    apu->writeRegister(0x4003, 0x00);
+    apu->tick(APU::CPU_CLOCK / 60);
+    apu->endFrame();
+
+    int peak = 0;
+    for (size_t i = 0; i < apu->getSampleCount(); i++) {
+        int sample = apu->getSamples()[i];
+        peak = sample > peak ? sample : peak;
+    }
+
+    if (apu->getSampleCount() >= APU::SAMPLE_RATE / 61 && peak > 1000) {
+        std::cout << GREEN << "APU pulse output test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "APU pulse output test failed" << RESET << std::endl;
+    }
+
+    delete apu;
+    apu = new APU();
+
+    apu->writeStatus(0x01);
+    apu->writeRegister(0x4000, 0x00);
+    apu->writeRegister(0x4003, 0x08);
+    uint8_t before = apu->readStatus();
+    apu->tick(29830);
+
+    if (before == 0x01 && apu->readStatus() == 0x41 && apu->readStatus() == 0x01) {
+        std::cout << GREEN << "APU length counter and frame IRQ test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "APU length counter and frame IRQ test failed" << RESET << std::endl;
+    }
+
+    delete apu;
+    apu = new APU();
+
+    apu->writeStatus(0x01);
+    apu->writeRegister(0x4000, 0x00);
+    apu->writeRegister(0x4003, 0x08);
+    apu->writeFrameCounter(0x80);
+    apu->tick(37282 * 2);
+
+    // 254, one half frame clock from the $4017 write and two per sequence
+    if (apu->pulse1.lengthCounter == 249 && !apu->pollIrq()) {
+        std::cout << GREEN << "APU 5-step sequencer test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "APU 5-step sequencer test failed" << RESET << std::endl;
+    }
+
+    delete apu;
+    apu = new APU();
+
+    // the noise channel is off, but its shift register is clocked every 4 cycles regardless
+    apu->writeRegister(0x400E, 0x00);
+    apu->tick(400);
+    apu->endFrame();
+    uint16_t expected = 1;
+    for (int i = 0; i < 100; i++) {
+        expected = (expected >> 1) | (((expected ^ (expected >> 1)) & 0x1) << 14);
+    }
+
+    if (apu->noise.idle() && apu->noise.shiftRegister == expected) {
+        std::cout << GREEN << "APU idle noise shift register test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "APU idle noise shift register test failed" << RESET << std::endl;
+    }
+
+    delete apu;
+
+    System* system = new System();
+    system->bus->write(0x4010, 0x0F);
+    system->bus->write(0x4012, 0x00);
+    system->bus->write(0x4013, 0x01);
+    system->bus->write(0x4015, 0x10);
+    uint16_t firstFetch = system->bus->takeStallCycles();
+    // the timer still runs out its power-on period before the rate change applies,
+    // then seven more bits at the fastest rate empty the sample buffer again
+    system->apu->tick(428 + 54 * 7);
+    uint16_t secondFetch = system->bus->takeStallCycles();
+    system->bus->write(0x4014, 0x02);
+
+    if (firstFetch == 4 && secondFetch == 4 && system->bus->takeStallCycles() == 513) {
+        std::cout << GREEN << "DMA stall test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "DMA stall test failed" << RESET << std::endl;
+    }
+
+    delete system;
+}
+
+void runSaveStateTests() {
+    System* system = new System();
+    system->bus->write(0x0010, 0x42);
+    system->bus->write(0x6000, 0x17);
+    system->bus->write(0x2006, 0x21);
+    system->bus->write(0x2006, 0x00);
+    system->bus->write(0x2007, 0x99);
+    system->bus->write(0x4015, 0x01);
+    system->bus->write(0x4003, 0x08);
+
+    uint8_t saved[System::SAVESTATE_SIZE];
+    size_t size = system->saveState(saved, sizeof(saved));
+
+    system->bus->write(0x0010, 0x00);
+    system->bus->write(0x6000, 0x00);
+    system->ppu->vram[0x0100] = 0x00;
+    system->apu->tick(29830 * 4);
+
+    uint8_t reloaded[System::SAVESTATE_SIZE];
+    bool loaded = size > 0 && system->loadState(saved, size);
+    size_t reloadedSize = system->saveState(reloaded, sizeof(reloaded));
+
+    if (loaded && system->bus->read(0x0010) == 0x42 && system->bus->read(0x6000) == 0x17 && system->ppu->vram[0x0100] == 0x99 &&
+        reloadedSize == size && std::memcmp(saved, reloaded, size) == 0) {
+        std::cout << GREEN << "Savestate round trip test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "Savestate round trip test failed" << RESET << std::endl;
+    }
+
+    saved[4]++;
+    if (!system->loadState(saved, size) && !system->loadState(saved, size - 1)) {
+        std::cout << GREEN << "Savestate version check test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "Savestate version check test failed" << RESET << std::endl;
+    }
+
+    delete system;
+}
+
+void runRewindTests() {
+    uint8_t data[4096];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = i % 512 < 300 ? 0 : static_cast<uint8_t>(i * 7);
+    }
+    uint8_t packed[lz::maxCompressedSize(sizeof(data))];
+    uint8_t unpacked[sizeof(data)];
+    size_t packedSize = lz::compress(data, sizeof(data), packed, sizeof(packed));
+    size_t unpackedSize = lz::decompress(packed, packedSize, unpacked, sizeof(unpacked));
+
+    if (packedSize > 0 && packedSize < sizeof(data) && unpackedSize == sizeof(data) && std::memcmp(data, unpacked, sizeof(data)) == 0) {
+        std::cout << GREEN << "LZ round trip test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "LZ round trip test failed" << RESET << std::endl;
+    }
+
+    System* system = new System();
+    RewindBuffer* rewind = new RewindBuffer(64 * 1024, 4);
+    for (int frame = 0; frame < 10; frame++) {
+        system->bus->write(0x0000, frame);
+        rewind->push(system);
+    }
+
+    bool restored = true;
+    for (int frame = 9; frame >= 0; frame--) {
+        restored = restored && rewind->pop(system) && system->bus->read(0x0000) == frame;
+    }
+
+    if (restored && !rewind->pop(system)) {
+        std::cout << GREEN << "Rewind push/pop test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "Rewind push/pop test failed" << RESET << std::endl;
+    }
+
+    delete rewind;
+    delete system;
+
+    // strobes the joypad forever and adds up how often A was held into $10
+    uint8_t program[] = {
+        0xA9, 0x01, 0x8D, 0x16, 0x40, 0xA9, 0x00, 0x8D, 0x16, 0x40,
+        0xAD, 0x16, 0x40, 0x29, 0x01, 0x18, 0x65, 0x10, 0x85, 0x10, 0x4C, 0x00, 0x80
+    };
+    uint8_t vector[] = { 0x00, 0x80 };
+    System* systems[2];
+    for (System*& machine : systems) {
+        machine = new System();
+        machine->bus->writeBytes(0x8000, program, sizeof(program));
+        machine->bus->writeBytes(0xFFFC, vector, sizeof(vector));
+        machine->power();
+    }
+
+    // record 30 frames, rewind 10 of them like the frontend does, then record 20 more
+    system = systems[0];
+    rewind = new RewindBuffer(256 * 1024, 4);
+    Movie* movie = new Movie();
+    size_t frame = 0;
+    for (int i = 0; i < 60; i++) {
+        if (i >= 30 && i < 40) {
+            if (rewind->stepBack(system, movie, nullptr, frame)) {
+                system->runFrame();
+            }
+            continue;
+        }
+        rewind->push(system);
+        system->joypad->setState(i % 3 == 0 ? JOYPAD_A : 0);
+        movie->record(system, 0);
+        system->runFrame();
+        frame++;
+    }
+
+    for (size_t i = 0; i < movie->frames.size(); i++) {
+        movie->apply(systems[1], i);
+        systems[1]->runFrame();
+    }
+
+    uint8_t recorded[System::SAVESTATE_SIZE];
+    uint8_t replayed[System::SAVESTATE_SIZE];
+    size_t recordedSize = systems[0]->saveState(recorded, sizeof(recorded));
+    size_t replayedSize = systems[1]->saveState(replayed, sizeof(replayed));
+    if (frame == 40 && movie->frames.size() == frame && recordedSize > 0 && recordedSize == replayedSize &&
+        std::memcmp(recorded, replayed, recordedSize) == 0) {
+        std::cout << GREEN << "Rewind while recording test passed" << RESET << std::endl;
+    } else {
+        std::cout << RED << "Rewind while recording test failed" << RESET << std::endl;
+    }
+
+    delete movie;
+    delete rewind;
+    delete systems[0];
+    delete systems[1];
+}
+
 // int main() {
 //     runPPUTests();
+//     runAPUTests();
+//     runSaveStateTests();
+//     runRewindTests();
 //     return 0;
 // }